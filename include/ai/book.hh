@@ -0,0 +1,103 @@
+/* -----------------------------------------------------------------------------
+book.hh
+
+Provides an opening book so the AI can answer known positions without search:
+    1. a book file is a header followed by BookEntry records sorted by key
+    2. "Book" memory-maps a file and binary searches it by position key
+    3. "BookBuilder" accumulates weighted actions from games and writes a file
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#ifndef BOOK_HH
+#define BOOK_HH
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "engine/board.hh"
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Identifies a book file and its layout version.
+const char BOOK_MAGIC[4] {'C', 'K', 'B', 'K'};
+const uint32_t BOOK_VERSION {1};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Leads every book file.
+struct BookHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+};
+
+// One book action: the position it is played from, the action and its weight.
+struct BookEntry {
+    uint64_t key;
+    uint32_t weight;
+    uint8_t src, dst;
+    uint16_t reserved;
+};
+
+static_assert(sizeof(BookHeader) == 16, "BookHeader must stay 16 bytes");
+static_assert(sizeof(BookEntry) == 16, "BookEntry must stay 16 bytes");
+
+////////////////////////////////////////////////////////////////////////////////
+
+class Book {
+    // mapped file
+    void *m_data = nullptr;
+    size_t m_size = 0;
+
+    // sorted records within the mapping
+    const BookEntry *m_entries = nullptr;
+    uint64_t m_count = 0;
+
+public:
+    Book() = default;
+    ~Book();
+    Book(const Book &) = delete;
+    Book &operator=(const Book &) = delete;
+
+    // maps a book file read-only (returns ACTION_SUCCESS or ACTION_FAILURE)
+    int open(const std::string &path);
+    void close();
+
+    // finds the range of entries stored for a position key
+    std::pair<const BookEntry *, const BookEntry *> find(uint64_t key) const;
+
+    // picks a book action by weight among those legal here (others are key
+    // collisions), writing the resulting position
+    bool probe(const Board &state, std::mt19937 &gen, Board &result) const;
+
+    // number of entries in the book
+    uint64_t size() const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class BookBuilder {
+    // weight accumulated per (key, src, dst)
+    std::map<std::pair<uint64_t, uint16_t>, uint32_t> m_weights;
+    int m_max_plies;
+
+public:
+    BookBuilder(int max_plies);
+
+    // adds the opening of a game; winner is BLACK, WHITE or -1 for a draw
+    void add_game(const History &history, int winner);
+
+    // writes all accumulated entries to a book file
+    int write(const std::string &path) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,119 @@
+/* -----------------------------------------------------------------------------
+cache.hh
+
+Provides a persistent analysis cache, so search results outlive the process
+and are shared by every engine on the machine:
+    1. a cache file is a header followed by 64-byte buckets of four slots
+    2. "AnalysisCache" maps a file (creating it if needed) and stores search
+       results by position key
+
+Scores depend on the evaluation weights, so the header records a fingerprint
+of the weights in use (see weights_fingerprint) and a file written under
+other weights is refused rather than read. Several processes may map one
+file at once. Reads and writes take no locks:
+each slot is stored as (key ^ data, data), so a slot torn by two concurrent
+writers fails the key check and reads as a miss. Each open starts a new
+generation, and a full bucket evicts the slot with the least depth, counting
+older generations as shallower.
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#ifndef CACHE_HH
+#define CACHE_HH
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Identifies a cache file and its layout version.
+const char CACHE_MAGIC[4] {'C', 'K', 'A', 'C'};
+const uint32_t CACHE_VERSION {2};
+
+// Default cache size, in megabytes.
+const size_t CACHE_DEFAULT_MB {64};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// How a cached score relates to the true score of the position.
+enum Bound {EXACT, LOWER, UPPER};
+
+// One search result, as stored in and read from the cache.
+struct CacheEntry {
+    float score;
+    int depth;
+    Bound bound;
+    int src, dst;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Leads every cache file.
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t buckets;
+    uint64_t fingerprint;
+    uint32_t generation;
+    uint32_t reserved[9];
+};
+
+// One slot: the key is stored xor'ed with the data it describes.
+struct CacheSlot {
+    uint64_t check;
+    uint64_t data;
+};
+
+// Four slots, filling one cache line.
+struct alignas(64) CacheBucket {
+    CacheSlot slots[4];
+};
+
+static_assert(sizeof(CacheHeader) == 64, "CacheHeader must stay 64 bytes");
+static_assert(sizeof(CacheBucket) == 64, "CacheBucket must stay 64 bytes");
+
+////////////////////////////////////////////////////////////////////////////////
+
+class AnalysisCache {
+    // mapped file
+    void *m_data = nullptr;
+    size_t m_size = 0;
+
+    // buckets within the mapping (a power of two)
+    CacheBucket *m_buckets = nullptr;
+    uint64_t m_count = 0;
+
+    // generation of this process's writes
+    uint32_t m_generation = 0;
+
+public:
+    AnalysisCache() = default;
+    ~AnalysisCache();
+    AnalysisCache(const AnalysisCache &) = delete;
+    AnalysisCache &operator=(const AnalysisCache &) = delete;
+
+    // maps a cache file read-write, creating it with the given size if it is
+    // missing or empty; an existing file keeps its own size, and one that is
+    // not a cache or was written under other weights fails to open (and is
+    // left as it is)
+    int open(const std::string &path, size_t megabytes = CACHE_DEFAULT_MB);
+    void close();
+
+    // looks up a position key, returning false on a miss
+    bool probe(uint64_t key, CacheEntry &entry) const;
+
+    // stores a result, replacing the least valuable slot of its bucket
+    void store(uint64_t key, const CacheEntry &entry);
+
+    // number of slots in the cache
+    uint64_t size() const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
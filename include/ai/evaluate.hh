@@ -0,0 +1,70 @@
+/* -----------------------------------------------------------------------------
+evaluate.hh
+
+Provides static evaluation of a Board as a weighted sum of features:
+    1. each feature is a black-minus-white count (higher better for black)
+    2. "Weights" holds one weight per feature, loadable from a text file
+    3. "quiesce" resolves pending takes before evaluating
+
+Weights file format, one feature per line ('#' starts a comment):
+    men 1.0
+    kings 1.25
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#ifndef EVALUATE_HH
+#define EVALUATE_HH
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "engine/board.hh"
+
+#include <cstdint>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Every feature of the evaluation.
+enum Feature {MEN, KINGS, BACK_RANK, CENTER, ADVANCE, NUM_FEATURES};
+
+// Names used in weights files.
+const char *const FEATURE_NAMES[NUM_FEATURES] {
+    "men", "kings", "back_rank", "center", "advance"
+};
+
+// One weight per feature; the defaults value a king at 1.25 men.
+struct Weights {
+    float w[NUM_FEATURES] {1.0, 1.25, 0.0, 0.0, 0.0};
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Gets and sets the weights used by the engine.
+const Weights &get_weights();
+void set_weights(const Weights &weights);
+
+// Identifies the weights in use (and the feature set), so scores computed
+// under other weights can be told apart.
+uint64_t weights_fingerprint();
+
+// Reads and writes weights files (returns ACTION_SUCCESS or ACTION_FAILURE).
+int load_weights(const std::string &path, Weights &weights);
+int save_weights(const std::string &path, const Weights &weights);
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Calculates the feature counts of a position.
+void get_features(const Board &state, int8_t features[NUM_FEATURES]);
+
+// Evaluates a position statically (higher better for black).
+float evaluate(const Board &state);
+float evaluate(const Board &state, const Weights &weights);
+
+// Plays out pending takes, returning the quiet position takes lead to.
+Board quiesce(const Board &state, const Weights &weights);
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
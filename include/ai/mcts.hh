@@ -0,0 +1,119 @@
+/* -----------------------------------------------------------------------------
+mcts.hh
+
+Provides a Monte Carlo tree search (PUCT) backend by:
+    1. storing the tree in a fixed arena of MctsNode, children contiguous
+    2. running simulations on several threads over one shared tree, using
+       virtual loss to spread threads across different branches; the helper
+       threads are started by the first search and reused by later ones
+    3. valuing leaves by static evaluation or by random playouts, squashed
+       to [-1, 1]; the reported score is converted back to evaluation units,
+       so it compares with MinMax's
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#ifndef MCTS_HH
+#define MCTS_HH
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "ai/search.hh"
+#include "ai/stats.hh"
+#include "engine/board.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Expansion states of an MctsNode.
+enum Expansion : uint8_t {UNEXPANDED, EXPANDING, EXPANDED};
+
+// One node of the arena; its children are nodes [first_child, + num_children).
+struct MctsNode {
+    Board state;
+    Color turn;
+    float prior;
+
+    uint32_t first_child;
+    uint32_t num_children;
+    std::atomic<uint8_t> expansion;
+
+    // visit count and total value (fixed point, for the player who moved here)
+    std::atomic<int32_t> visits;
+    std::atomic<int64_t> value;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class Mcts : public Search {
+    Color m_playing_for;
+    int m_search_depth;
+
+    // tree storage, allocated on first use and reused by later searches
+    std::unique_ptr<MctsNode[]> m_arena;
+    uint32_t m_allocated = 0;
+    uint32_t m_capacity;
+    std::atomic<uint32_t> m_size {0};
+
+    // simulations run and simulations allowed
+    std::atomic<long> m_simulations {0};
+    long m_budget = 0;
+
+    unsigned m_threads;
+    bool m_playouts;
+
+    // counters merged from helper threads
+    SearchStats m_stats;
+
+    // helper threads, woken once per search ("round") with its time limit
+    std::vector<std::thread> m_helpers;
+    std::mutex m_mutex;
+    std::condition_variable m_round_start;
+    std::condition_variable m_round_done;
+    uint64_t m_round = 0;
+    unsigned m_busy = 0;
+    double m_seconds = 0;
+    bool m_stopping = false;
+
+public:
+    Mcts(Color playing_for, int search_depth, unsigned threads = 1,
+         bool playouts = false, uint32_t capacity = 1 << 18);
+    ~Mcts() override;
+
+    Board best_move(const Board &state) override;
+    SearchResult search(const Board &state, const Limits &limits) override;
+
+private:
+    // a helper thread's loop: works through each round until stopped
+    void help();
+
+    // runs simulations until the budget or deadline is spent
+    void work(double seconds);
+
+    // one selection, expansion, evaluation and backup
+    void simulate(std::vector<uint32_t> &path);
+
+    // creates the children of a node, returning false if the arena is full
+    bool expand(uint32_t index);
+
+    // picks the child with the highest PUCT score
+    uint32_t select(uint32_t index) const;
+
+    // finds the most visited child, or null if no child was visited
+    const MctsNode *best_child(const MctsNode &node) const;
+
+    // values a leaf from black's point of view in [-1, 1]
+    float value(const MctsNode &node) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
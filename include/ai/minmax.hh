@@ -1,51 +1,78 @@
-/* -----------------------------------------------------------------------------
-minmax.hh
-
-Name: Joseph Sturm
-Date: 01/27/2020
------------------------------------------------------------------------------ */
-
-#ifndef MINMAX_HH
-#define MINMAX_HH
-
-////////////////////////////////////////////////////////////////////////////////
-
-#include "engine/Board.hh"
-
-#include <vector>
-
-////////////////////////////////////////////////////////////////////////////////
-
-class Node {
-    Board m_state;
-    std::vector<Node> m_children;
-    float m_eval;
-
-private:
-    Node(const Board &state);
-    void find_children(Color col);
-
-private:
-    friend class MinMax;
-};
-
-////////////////////////////////////////////////////////////////////////////////
-
-class MinMax {
-    Color m_playing_for;
-    int m_search_depth;
-    
-public:
-    MinMax(Color playing_for, int search_depth);
-    Board best_move(const Board &state);
-
-private:
-    void expand(Node &current, int counter);
-    Node &propagate(Node &current, bool maxing);
-    static Node max_node(const Node &n1, const Node &n2);
-    static Node min_node(const Node &n1, const Node &n2);
-};
-
-////////////////////////////////////////////////////////////////////////////////
-
-#endif
\ No newline at end of file
+/* -----------------------------------------------------------------------------
+minmax.hh
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#ifndef MINMAX_HH
+#define MINMAX_HH
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "ai/search.hh"
+#include "engine/board.hh"
+
+#include <chrono>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Deepest search MinMax runs (deeper limits are clamped).
+const int MAX_SEARCH_DEPTH {64};
+
+// The storage for one ply of the search, so the search allocates nothing once
+// its frames exist: the actions of the position at this ply and their values,
+// and the principal variation found below it.
+struct SearchFrame {
+    Board children[Board::MAX_ACTIONS];
+    float values[Board::MAX_ACTIONS];
+    int count;
+
+    Action pv[MAX_SEARCH_DEPTH];
+    int pv_length;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class MinMax : public Search {
+    Color m_playing_for;
+    int m_search_depth;
+
+    // per-search node count, time and node limits
+    long m_nodes = 0;
+    long m_node_limit = 0;
+    bool m_timed = false;
+    bool m_aborted = false;
+    std::chrono::steady_clock::time_point m_deadline;
+
+    // one frame per ply, grown (never shrunk) before a search starts
+    std::vector<SearchFrame> m_frames;
+
+    // the lowest key stack position a draw scored in the current subtree
+    // depends on (INT_MAX if none); a node whose draws reach above it is
+    // not cached
+    int m_draw_origin = 0;
+    
+public:
+    MinMax(Color playing_for, int search_depth);
+    Board best_move(const Board &state) override;
+
+    // deepens iteratively until the depth, time or node limit is reached
+    SearchResult search(const Board &state, const Limits &limits) override;
+
+private:
+    // searches the root, dispatching on its side to move; the root's actions
+    // and values are left in the first frame (returns false if stopped)
+    bool run(const Board &root, int depth, float &eval);
+
+    // searches a position with C to move, returning its value
+    template <Color C> float search_node(const Board &state, int depth, int ply);
+
+    // answers a position from the analysis cache, if searched deep enough
+    bool probe_node(const Board &state, int depth, float &eval);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
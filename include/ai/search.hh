@@ -0,0 +1,111 @@
+/* -----------------------------------------------------------------------------
+search.hh
+
+Provides the interface shared by every AI backend:
+    1. "Limits" bounds a search by depth, time or nodes
+    2. "SearchResult" reports the best action, score, PV and effort
+    3. "SearchStats" (see stats.hh) counts what the search did
+    4. "Search" is the base class of MinMax and Mcts, holding the opening book,
+       analysis cache (see cache.hh) and random generator they share, and the
+       positions of the game being played (see draw.hh)
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#ifndef SEARCH_HH
+#define SEARCH_HH
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "ai/stats.hh"
+#include "engine/board.hh"
+#include "engine/draw.hh"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+class AnalysisCache;
+class Book;
+struct CacheEntry;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Score of a side with no legal action, which has lost (negated when black
+// has lost); every backend reports decided games with it.
+const float LOSS_EVAL {1e3};
+
+// Bounds a single search by depth and (optionally) wall-clock time or nodes.
+struct Limits {
+    int depth;
+    double seconds = 0;
+    long nodes = 0;
+};
+
+// Everything a search found; scores are from black's point of view.
+struct SearchResult {
+    Board best;
+    float score;
+    std::vector<Action> pv;
+    long nodes;
+    int depth;
+    SearchStats stats;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class Search {
+    // opening book and analysis cache shared by every search (may be null)
+    static const Book *s_book;
+    static AnalysisCache *s_cache;
+
+protected:
+    // positions of the game before the one it reached, and that one's key
+    KeyStack m_keys;
+    uint64_t m_game_key = 0;
+
+public:
+    virtual ~Search() = default;
+
+    // sets the game leading to the next position searched, so repetitions
+    // of its earlier positions count as draws (ignored for other positions)
+    void set_game(const GameRecord &game);
+
+    // chooses the AI's next action (consulting the book first)
+    virtual Board best_move(const Board &state) = 0;
+
+    // searches a position within the given limits
+    virtual SearchResult search(const Board &state, const Limits &limits) = 0;
+
+    // sets the opening book consulted before searching
+    static void use_book(const Book *book);
+
+    // sets the analysis cache searches read and write
+    static void use_cache(AnalysisCache *cache);
+
+    // seeds the generator used for tie-breaks and book choices
+    static void seed(unsigned seed);
+
+protected:
+    // looks the position up in the opening book
+    static bool probe_book(const Board &state, Board &result);
+
+    // looks the position up in, or adds it to, the analysis cache
+    static bool probe_cache(const Board &state, CacheEntry &entry);
+    static void store_cache(const Board &state, const CacheEntry &entry);
+
+    // the calling thread's generator
+    static std::mt19937 &generator();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Creates a search backend playing for one color to the given depth.
+std::unique_ptr<Search> make_search(Backend backend, Color playing_for, int depth);
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,93 @@
+/* -----------------------------------------------------------------------------
+stats.hh
+
+Provides counters describing where a search spends its time. Counters live in
+thread-local storage, so incrementing one is a single add with no sharing
+between threads. Each search clears its thread's counters when it starts and
+returns a copy in SearchResult::stats.
+
+Building with CHECKERS_STATS=0 compiles every STATS_* statement away.
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#ifndef STATS_HH
+#define STATS_HH
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CHECKERS_STATS
+#define CHECKERS_STATS 1
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Histogram sizes: the last bucket also counts everything above it.
+const auto STATS_MOVES {32};
+const auto STATS_DEPTHS {64};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Counters for one search (plain data so thread-local access is cheap).
+struct SearchStats {
+    uint64_t nodes;
+    uint64_t leaf_evals;
+    uint64_t movegen_calls;
+    uint64_t tt_probes;
+    uint64_t tt_hits;
+    uint64_t quiescence_nodes;
+
+    // subtrees answered by the cache instead of searched, by the index of
+    // the move leading to them
+    uint64_t cutoffs[STATS_MOVES];
+
+    // expanded nodes by their number of children
+    uint64_t branching[STATS_MOVES];
+
+    // seconds spent on each iteration of iterative deepening
+    double depth_seconds[STATS_DEPTHS];
+
+    void clear();
+    SearchStats &operator+=(const SearchStats &other);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Summarizes counters as space-separated "name=value" pairs.
+std::string format_stats(const SearchStats &stats);
+
+// The calling thread's counters.
+inline SearchStats &thread_stats() {
+    thread_local SearchStats stats;
+    return stats;
+}
+
+// Clamps a count to the last histogram bucket.
+inline int stats_bucket(uint64_t n, int buckets) {
+    return (n < (uint64_t)buckets) ? (int)n : buckets - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#if CHECKERS_STATS
+#define STATS_ADD(field, n) (thread_stats().field += (n))
+#define STATS_CUTOFF(index) (++thread_stats().cutoffs[stats_bucket((index), STATS_MOVES)])
+#define STATS_BRANCHING(n) (++thread_stats().branching[stats_bucket((n), STATS_MOVES)])
+#define STATS_DEPTH_TIME(depth, s) \
+    (thread_stats().depth_seconds[stats_bucket((depth), STATS_DEPTHS)] += (s))
+#else
+#define STATS_ADD(field, n) ((void)0)
+#define STATS_CUTOFF(index) ((void)0)
+#define STATS_BRANCHING(n) ((void)0)
+#define STATS_DEPTH_TIME(depth, s) ((void)0)
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
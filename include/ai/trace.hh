@@ -0,0 +1,160 @@
+/* -----------------------------------------------------------------------------
+trace.hh
+
+Provides an opt-in trace of what searches do, for finding out afterwards why
+one took far longer than expected:
+    1. "TraceEvent" is one 16-byte event: a search or iteration beginning or
+       ending, a sampled node entry or exit, a cache hit, a cutoff or a check
+       of the clock
+    2. each thread records into its own lock-free ring buffer, which a
+       background thread drains to the trace file; a thread's ring and id
+       pass to a later thread once it exits
+    3. "start_trace"/"stop_trace" turn recording on and off
+
+The trace tool converts a trace file to Chrome trace_event JSON, for viewing
+in chrome://tracing or Perfetto.
+
+File layout:
+    header      magic "CKTR", version, sample rate
+    events      TraceEvent, in order per thread (threads interleave)
+
+While tracing is off each TRACE_* statement is one relaxed load; building
+with CHECKERS_TRACE=0 compiles them away. A thread whose ring is full drops
+events rather than waiting, and the trace records how many it dropped.
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#ifndef TRACE_HH
+#define TRACE_HH
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CHECKERS_TRACE
+#define CHECKERS_TRACE 1
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Identifies a trace file and its layout version.
+const char TRACE_MAGIC[4] {'C', 'K', 'T', 'R'};
+const uint32_t TRACE_VERSION {1};
+
+// By default one node in this many is traced.
+const uint32_t TRACE_DEFAULT_RATE {1024};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// What an event records; "ply" and "value" of each are noted alongside.
+enum TraceType : uint8_t {
+    SEARCH_BEGIN,       // -, depth limit
+    SEARCH_END,         // -, nodes
+    ITERATION_BEGIN,    // depth, -
+    ITERATION_END,      // depth, nodes
+    NODE_ENTER,         // ply, depth left
+    NODE_EXIT,          // ply, -
+    CACHE_HIT,          // -, cached depth
+    CUTOFF,             // ply, index of the move
+    TIME_CHECK,         // ply, 1 if the search stopped
+    EVENTS_DROPPED,     // -, events lost to a full ring
+    NUM_TRACE_TYPES
+};
+
+// One event, timed in nanoseconds from the start of the trace.
+struct TraceEvent {
+    uint64_t time;
+    uint16_t thread;
+    uint8_t type;
+    uint8_t ply;
+    uint32_t value;
+};
+
+// Leads every trace file.
+struct TraceHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t sample_rate;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(TraceEvent) == 16, "TraceEvent must stay 16 bytes");
+static_assert(sizeof(TraceHeader) == 16, "TraceHeader must stay 16 bytes");
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Starts recording every thread's events to a file, tracing one node in
+// "sample_rate" (returns ACTION_SUCCESS or ACTION_FAILURE).
+int start_trace(const std::string &path,
+                uint32_t sample_rate = TRACE_DEFAULT_RATE);
+
+// Stops recording, writing out every event still buffered.
+void stop_trace();
+
+// Records one event from the calling thread (see the TRACE_* macros).
+void trace_event(TraceType type, int ply, uint32_t value);
+
+// Whether events are being recorded.
+inline std::atomic<bool> &trace_enabled() {
+    static std::atomic<bool> enabled {false};
+    return enabled;
+}
+
+// Nodes per traced node.
+inline std::atomic<uint32_t> &trace_rate() {
+    static std::atomic<uint32_t> rate {TRACE_DEFAULT_RATE};
+    return rate;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Traces a node's entry and exit, if this thread's sample count says so.
+class TraceNode {
+    int m_ply;
+    bool m_sampled = false;
+
+public:
+    TraceNode(int ply, int depth) : m_ply(ply) {
+        if (!trace_enabled().load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        thread_local uint32_t countdown = 1;
+        if (--countdown == 0) {
+            countdown = trace_rate().load(std::memory_order_relaxed);
+            m_sampled = true;
+            trace_event(NODE_ENTER, ply, depth);
+        }
+    }
+
+    ~TraceNode() {
+        if (m_sampled) {
+            trace_event(NODE_EXIT, m_ply, 0);
+        }
+    }
+
+    TraceNode(const TraceNode &) = delete;
+    TraceNode &operator=(const TraceNode &) = delete;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#if CHECKERS_TRACE
+#define TRACE_EVENT(type, ply, value) \
+    (trace_enabled().load(std::memory_order_relaxed) \
+        ? trace_event((type), (ply), (value)) : (void)0)
+#define TRACE_NODE(ply, depth) TraceNode trace_node_((ply), (depth))
+#else
+#define TRACE_EVENT(type, ply, value) ((void)0)
+#define TRACE_NODE(ply, depth) ((void)0)
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
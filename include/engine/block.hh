@@ -0,0 +1,80 @@
+/* -----------------------------------------------------------------------------
+block.hh
+
+Provides move generation over many unrelated 8x8 positions at once, for perft,
+tuning and batch analysis:
+    1. "BoardBlock" stores a block of positions as separate black, white and
+       kings arrays, so one vector register holds the same bitboard of several
+       positions
+    2. "BlockActors" holds the mover and taker masks of every position
+    3. "BoardBlock::find_actors" computes them with AVX-512 or AVX2 shifts and
+       ANDs when the CPU has them, and one position at a time otherwise
+
+The masks are those of Board::get_movers/get_takers for the side to move,
+including the rule that a side able to take cannot move. A block has no side
+to move or pending multi-take of its own: every position is taken to be at
+the start of a turn of the color asked for.
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#ifndef BLOCK_HH
+#define BLOCK_HH
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "engine/board.hh"
+
+#include <cstdint>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Positions per block: a whole number of 512-bit vectors.
+const int BLOCK_SIZE {64};
+
+// Instruction sets a block kernel can use, narrowest first.
+enum BlockKernel {SCALAR_KERNEL, AVX2_KERNEL, AVX512_KERNEL};
+
+// Names used in benchmark reports.
+const char *const KERNEL_NAMES[3] {"scalar", "avx2", "avx512"};
+
+// Finds the widest kernel the running CPU supports.
+BlockKernel best_kernel();
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Mover and taker masks of every position in a block, first by direction
+// (indexed as Geometry::DIRS: NW, NE, SW, SE), then by position.
+struct BlockActors {
+    alignas(64) uint64_t moves[4][BLOCK_SIZE];
+    alignas(64) uint64_t takes[4][BLOCK_SIZE];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class BoardBlock {
+    // one bitboard word per position; unused positions stay empty
+    alignas(64) uint64_t m_black[BLOCK_SIZE] {};
+    alignas(64) uint64_t m_white[BLOCK_SIZE] {};
+    alignas(64) uint64_t m_kings[BLOCK_SIZE] {};
+    int m_count = 0;
+
+public:
+    // adds the pieces of a position, returning false if the block is full
+    bool add(const Board &board);
+
+    // empties the block
+    void clear();
+
+    // number of positions held
+    int size() const;
+
+    // finds the movers and takers of every position with "turn" to move
+    void find_actors(Color turn, BlockActors &actors,
+                     BlockKernel kernel = best_kernel()) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
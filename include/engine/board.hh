@@ -1,162 +1,300 @@
-/* -----------------------------------------------------------------------------
-board.hh
-
-Provides tools to represent and manipulate a checkers board by:
-    1. implementing a data structure to indicate piece positions (Position)
-    2. implementing a data structure to hold a history of actions (History)
-    3. defining "Board" class as three Positions (B, W, K) and a History
-    4. providing methods to observe and manipulate the Board
-
-Position notation:
-    xx 41 xx 42 xx 43 xx 44 xx 45
-    36 -- 37 -- 38 -- 39 -- 40 xx
-    xx 32 -- 33 -- 34 -- 35 -- 36
-    27 -- 28 -- 29 -- 30 -- 31 xx
-    xx 23 -- 24 -- 25 -- 26 -- 27
-    18 -- 19 -- 20 -- 21 -- 22 xx
-    xx 14 -- 15 -- 16 -- 17 -- 18
-    09 -- 10 -- 11 -- 12 -- 13 xx
-    xx 05 -- 06 -- 07 -- 08 -- 09
-    00 xx 01 xx 02 xx 03 xx 04 xx
-
-Name: Joseph Sturm
-Date: 01/27/2020
------------------------------------------------------------------------------ */
-
-#ifndef ENGINE_HH
-#define ENGINE_HH
-
-////////////////////////////////////////////////////////////////////////////////
-
-#include <bitset>
-#include <vector>
-
-////////////////////////////////////////////////////////////////////////////////
-
-#define ACTION_SUCCESS 0
-#define ACTION_FAILURE 1
-
-////////////////////////////////////////////////////////////////////////////////
-
-// A total of 46 squares must be represented.
-const auto BOARD_SIZE {46};
-
-////////////////////////////////////////////////////////////////////////////////
-
-// Piece locations are stored using bitsets.
-using Position = std::bitset<BOARD_SIZE>;
-
-// Promotion squares for black, white pieces.
-const Position TOP_ROW {0x1E000000000};
-const Position BOT_ROW {0x000000001E0};
-
-// The set of all squares a piece can occupy.
-const Position ON_BOARD {0x1EFF7FBFDE0};
-
-// Starting squares for black, white, king pieces (empty).
-const Position BLACK_START {0x0000003FDE0};
-const Position WHITE_START {0x1EFF0000000};
-const Position EMPTY_BOARD {0x00000000000};
-
-////////////////////////////////////////////////////////////////////////////////
-
-// Stores the set of all actors (of a certain type).
-struct Actors {
-    Position nw {EMPTY_BOARD};
-    Position ne {EMPTY_BOARD};
-    Position sw {EMPTY_BOARD};
-    Position se {EMPTY_BOARD};
-    bool any_action;
-};
-
-////////////////////////////////////////////////////////////////////////////////
-
-// Stores all information about a specific square.
-struct Square {
-    bool is_black, is_white, is_kings;
-    bool move_nw, move_ne, move_sw, move_se;
-    bool take_nw, take_ne, take_sw, take_se;
-};
-
-////////////////////////////////////////////////////////////////////////////////
-
-// A player can play black or white pieces.
-enum Color {BLACK, WHITE};
-
-// The types of action a player can take.
-enum Type {NONE, MOVE, TAKE};
-
-// Fully represents one action taken during a turn.
-struct Action {
-    Color color;
-    Type type;
-    int src, dst;
-    bool promoted;
-    // TODO: possibly store a Board here?
-};
-
-// The board "History" is every past action.
-using History = std::vector<Action>;
-
-////////////////////////////////////////////////////////////////////////////////
-
-class Board {
-    // piece locations
-    Position m_black = BLACK_START;
-    Position m_white = WHITE_START;
-    Position m_kings = EMPTY_BOARD;
-
-    // board history
-    History m_history;
-    
-public:
-    // the player chooses an action
-    int player_move(int sq, int dir, Square *info = nullptr);
-    int player_take(int sq, int dir, Square *info = nullptr);
-    
-    // the AI to chooses an action
-    Board ai_black_action(int depth) const;
-    Board ai_white_action(int depth) const;
-    
-    // calculates info about a square
-    Square get_square_info(int sq) const;
-
-    // gets a list of possible actions
-    std::vector<Board> get_black_actions() const;
-    std::vector<Board> get_white_actions() const;
-
-    // get position of pieces
-    const Position &get_black() const;
-    const Position &get_white() const;
-    const Position &get_kings() const;
-    
-    // get board history
-    const History &get_history() const;
-
-private:
-    // finds all open squares
-    Position get_open_squares() const;
-
-    // finds all pieces that can move
-    Actors get_black_movers() const;
-    Actors get_white_movers() const;
-
-    // finds all pieces that can take
-    Actors get_black_takers() const;
-    Actors get_white_takers() const;
-
-private:
-    // writes moves to board
-    void move_black(int sq, int dir);    
-    void move_white(int sq, int dir);
-    void move_kings(int sq, int dir);
-    
-    // writes takes to board
-    void take_black(int sq, int dir);
-    void take_white(int sq, int dir);
-    void take_kings(int sq, int dir);
-};
-
-////////////////////////////////////////////////////////////////////////////////
-
+/* -----------------------------------------------------------------------------
+board.hh
+
+Provides tools to represent and manipulate a checkers board by:
+    1. implementing a data structure to indicate piece positions (Position)
+    2. implementing a data structure to hold a history of actions (History)
+    3. defining "Board" class as three Positions (B, W, K), the side to move
+       and the action that produced it, templated on the board geometry
+       (8x8 "Board", 10x10 "Board10x10", which has English rules)
+    4. providing methods to observe and manipulate the Board
+    5. defining "GameRecord", the append-only log of a game played on a Board
+
+A Board is a small trivially copyable value, so it can be copied, hashed and
+stored in bulk; anything that needs the moves of a game keeps a GameRecord.
+
+Position notation (8x8, see geometry.hh for other sizes):
+    xx 41 xx 42 xx 43 xx 44 xx 45
+    36 -- 37 -- 38 -- 39 -- 40 xx
+    xx 32 -- 33 -- 34 -- 35 -- 36
+    27 -- 28 -- 29 -- 30 -- 31 xx
+    xx 23 -- 24 -- 25 -- 26 -- 27
+    18 -- 19 -- 20 -- 21 -- 22 xx
+    xx 14 -- 15 -- 16 -- 17 -- 18
+    09 -- 10 -- 11 -- 12 -- 13 xx
+    xx 05 -- 06 -- 07 -- 08 -- 09
+    00 xx 01 xx 02 xx 03 xx 04 xx
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#ifndef BOARD_HH
+#define BOARD_HH
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "engine/geometry.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define ACTION_SUCCESS 0
+#define ACTION_FAILURE 1
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The standard 8x8 board needs a total of 46 squares.
+constexpr int BOARD_SIZE = EnglishGeometry::SIZE;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Piece locations are stored using bitboards.
+using Position = EnglishGeometry::Position;
+
+// Promotion squares for black, white pieces.
+constexpr Position TOP_ROW = EnglishGeometry::TOP_ROW;
+constexpr Position BOT_ROW = EnglishGeometry::BOT_ROW;
+
+// The set of all squares a piece can occupy.
+constexpr Position ON_BOARD = EnglishGeometry::ON_BOARD;
+
+// Starting squares for black, white, king pieces (empty).
+constexpr Position BLACK_START = EnglishGeometry::BLACK_START;
+constexpr Position WHITE_START = EnglishGeometry::WHITE_START;
+constexpr Position EMPTY_BOARD {};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Stores the set of all actors (of a certain type).
+template <typename G>
+struct Actors {
+    typename G::Position nw {};
+    typename G::Position ne {};
+    typename G::Position sw {};
+    typename G::Position se {};
+    bool any_action;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Stores all information about a specific square.
+struct Square {
+    bool is_black, is_white, is_kings;
+    bool move_nw, move_ne, move_sw, move_se;
+    bool take_nw, take_ne, take_sw, take_se;
+};
+
+// Stores the legal actions of every square of one position. Bit i of a mask
+// is direction Geometry::DIRS[i] (NW, NE, SW, SE).
+template <typename G>
+struct ActionMap {
+    uint8_t moves[G::SIZE];
+    uint8_t takes[G::SIZE];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// A player can play black or white pieces.
+enum Color {BLACK, WHITE};
+
+// Compile-time facts about each color, so per-color code is specialized.
+template <Color C> struct ColorTraits;
+
+template <> struct ColorTraits<BLACK> {
+    static constexpr Color OTHER = WHITE;
+    static constexpr bool MEN_NORTH = true;
+};
+
+template <> struct ColorTraits<WHITE> {
+    static constexpr Color OTHER = BLACK;
+    static constexpr bool MEN_NORTH = false;
+};
+
+// The search algorithms the AI can use.
+enum Backend {MINMAX_SEARCH, MCTS_SEARCH};
+
+// Offsets between cornerwise squares on the standard board.
+enum Direction {
+    NW = EnglishGeometry::NW, NE = EnglishGeometry::NE,
+    SW = EnglishGeometry::SW, SE = EnglishGeometry::SE
+};
+
+// The types of action a player can take.
+enum Type {NONE, MOVE, TAKE};
+
+// Fully represents one action taken during a turn.
+struct Action {
+    Color color;
+    Type type;
+    int src, dst;
+    bool promoted;
+};
+
+// Finds an action's type from its squares; a take jumps over a square, so it
+// spans farther than any single step.
+inline Type action_type(int src, int dst) {
+    return (std::abs(dst - src) > NE) ? TAKE : MOVE;
+}
+
+// The board "History" is every past action.
+using History = std::vector<Action>;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// A board of geometry G (see geometry.hh); each geometry is compiled separately.
+template <typename G>
+class BasicBoard {
+public:
+    using Position = typename G::Position;
+
+private:
+    // piece locations
+    Position m_black = G::BLACK_START;
+    Position m_white = G::WHITE_START;
+    Position m_kings {};
+
+    // side to move, and the square of a piece that must take again (or -1)
+    uint8_t m_turn = BLACK;
+    int8_t m_pending = -1;
+
+    // the action that produced this position (type NONE if there was none)
+    uint8_t m_last_color = WHITE;
+    uint8_t m_last_type = NONE;
+    int8_t m_last_src = -1;
+    int8_t m_last_dst = -1;
+    bool m_last_promoted = false;
+
+public:
+    // most actions one position can have
+    static constexpr int MAX_ACTIONS = G::MAX_ACTIONS;
+
+    // sets up the starting position, or any position with a side to move
+    BasicBoard() = default;
+    BasicBoard(const Position &black, const Position &white,
+               const Position &kings, Color turn);
+
+    // the player chooses an action
+    int player_move(int sq, int dir, Square *info = nullptr);
+    int player_take(int sq, int dir, Square *info = nullptr);
+    int player_action(const Action &action);
+    
+    // the AI to chooses an action (standard board only)
+    BasicBoard ai_black_action(int depth, Backend backend = MINMAX_SEARCH) const;
+    BasicBoard ai_white_action(int depth, Backend backend = MINMAX_SEARCH) const;
+    
+    // calculates info about a square (see get_action_map)
+    Square get_square_info(int sq) const;
+
+    // calculates the legal actions of every square; the last map built on
+    // each thread is kept, so repeated queries on one position are O(1)
+    ActionMap<G> get_action_map() const;
+
+    // finds the color whose turn it is
+    Color get_turn() const;
+
+    // fetches the action that produced this position
+    Action get_last_action() const;
+
+    // calculates the Zobrist hash of the position
+    uint64_t get_key() const;
+
+    // gets a list of possible actions
+    template <Color C> std::vector<BasicBoard> get_actions() const;
+    std::vector<BasicBoard> get_actions(Color turn) const;
+
+    // writes the possible actions to "actions" (room for MAX_ACTIONS) without
+    // allocating, returning how many there are
+    template <Color C> int get_actions(BasicBoard *actions) const;
+    int get_actions(Color turn, BasicBoard *actions) const;
+
+    // get position of pieces
+    const Position &get_black() const;
+    const Position &get_white() const;
+    const Position &get_kings() const;
+
+private:
+    // finds all open squares
+    Position get_open_squares() const;
+
+    // gets the pieces of one color
+    template <Color C> const Position &get_side() const;
+    template <Color C> Position &get_side();
+
+    // finds all pieces that can move
+    template <Color C> Actors<G> get_movers() const;
+
+    // finds all pieces that can take
+    template <Color C> Actors<G> get_takers() const;
+
+    // fetches the action map of this position, building it on a miss
+    const ActionMap<G> &get_cached_map() const;
+
+    // builds the action map for the side to move
+    template <Color C> void build_action_map(ActionMap<G> &map) const;
+
+    // checks whether two boards have the same pieces and side to move
+    bool same_position(const BasicBoard &other) const;
+
+private:
+    // records an action, and whose turn follows it
+    template <Color C> void end_action(Type type, int src, int dst,
+                                       bool promoted);
+
+    // writes moves to board
+    template <Color C> void move(int sq, int dir);
+    
+    // writes takes to board
+    template <Color C> void take(int sq, int dir);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The standard 8x8 board, and a 10x10 board. Only the geometry is
+// generalized: a Board10x10 still plays English rules (men take forward only,
+// kings step one square, any take may be chosen), not international draughts.
+using Board = BasicBoard<EnglishGeometry>;
+using Board10x10 = BasicBoard<Geometry10x10>;
+
+// Search is only implemented for the standard board.
+template <> Board Board::ai_black_action(int depth, Backend backend) const;
+template <> Board Board::ai_white_action(int depth, Backend backend) const;
+
+// Positions are plain values: three bitboards and a few bytes of state.
+static_assert(std::is_trivially_copyable<Board>::value, "Board must be POD");
+static_assert(sizeof(Board) <= 32, "Board must fit in 32 bytes");
+
+////////////////////////////////////////////////////////////////////////////////
+
+// An append-only log of one game: where it started and every action since.
+class GameRecord {
+    Board m_start;
+    Board m_board;
+    History m_history;
+
+public:
+    GameRecord() = default;
+    explicit GameRecord(const Board &start);
+
+    // applies an action to the current board, appending it on success
+    int play(const Action &action);
+
+    // appends a board one action on from the current one (e.g. a search
+    // result, or an element of get_actions)
+    void append(const Board &next);
+
+    // get the starting and current boards
+    const Board &get_start() const;
+    const Board &get_board() const;
+
+    // get every action since the start
+    const History &get_history() const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
 #endif
\ No newline at end of file
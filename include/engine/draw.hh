@@ -0,0 +1,97 @@
+/* -----------------------------------------------------------------------------
+draw.hh
+
+Provides the draw rules of a game and of the positions a search passes
+through:
+    1. a position repeated since the last irreversible action is drawn
+    2. so is one reached by DRAW_PLIES reversible plies in a row (40 moves by
+       each side), where only a king's plain move is reversible
+    3. "KeyStack" holds the position keys of a game, then of the search path
+       below it, and detects both in O(1) for nearly every position
+
+A repetition can only reach back over reversible plies, so only the positions
+since the last take or man move are compared. A small table counting keys by
+their low bits rules out most repetitions without even that, and positions
+reached by irreversible actions are not hashed unless a later reversible ply
+needs them.
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#ifndef DRAW_HH
+#define DRAW_HH
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "engine/board.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Reversible plies in a row that draw the game (40 moves by each side).
+const int DRAW_PLIES {80};
+
+// Checks whether the action that produced a position was reversible.
+bool is_reversible(const Board &board);
+
+////////////////////////////////////////////////////////////////////////////////
+
+class KeyStack {
+    // bits of the key used to index the count table
+    static constexpr int FILTER_BITS = 12;
+
+    struct Entry {
+        uint64_t key;
+        const Board *board;
+        int reversible;
+        bool keyed;
+    };
+
+    std::vector<Entry> m_entries;
+
+    // keyed entries by the low bits of their key
+    std::vector<uint16_t> m_counts;
+
+public:
+    KeyStack();
+
+    // replaces the stack with every position of a game, oldest first
+    void assign(const GameRecord &game);
+
+    // adds a position on top; the board must outlive its entry, since its
+    // key may only be computed once a later position needs it
+    void push(const Board &board);
+
+    // removes the top position
+    void pop();
+
+    // removes every position
+    void clear();
+
+    // makes room for a number of positions, so later pushes never allocate
+    void reserve(size_t size);
+
+    // number of positions held
+    size_t size() const;
+
+    // reversible plies that led to the top position
+    int reversible() const;
+
+    // counts earlier occurrences of the top position
+    int repetitions() const;
+
+    // checks whether the top position is drawn (see the rules above)
+    bool is_draw() const;
+
+private:
+    // computes an entry's key, counting it in the table
+    void set_key(Entry &entry, uint64_t key);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,263 @@
+/* -----------------------------------------------------------------------------
+geometry.hh
+
+Describes the shape of a board at compile time, so each variant gets its own
+fully specialized move generation:
+    1. "Bitboard" is a fixed-width set of squares on a 64 or 128-bit word
+    2. "Geometry" derives the padded layout, direction offsets, promotion rows
+       and start masks from the board dimensions
+    3. "NEIGHBORS" tables each square's cornerwise step and jump squares
+
+Every board uses the same padded layout: rows of W/2 playable squares, with
+one unused square after every second row, so that the cornerwise offsets are
+the same from every square and a step off the side of the board lands on an
+unused square. For 8x8 this is the 46-bit layout drawn in board.hh.
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#ifndef GEOMETRY_HH
+#define GEOMETRY_HH
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <type_traits>
+
+////////////////////////////////////////////////////////////////////////////////
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+// Finds the lowest set bit of a non-zero word.
+inline int lowest_bit(uint64_t bits) {
+    return __builtin_ctzll(bits);
+}
+
+inline int lowest_bit(uint128_t bits) {
+    const uint64_t low = (uint64_t)bits;
+    return low ? __builtin_ctzll(low)
+               : 64 + __builtin_ctzll((uint64_t)(bits >> 64));
+}
+
+// Counts the set bits of a word.
+inline int count_bits(uint64_t bits) {
+    return __builtin_popcountll(bits);
+}
+
+inline int count_bits(uint128_t bits) {
+    return __builtin_popcountll((uint64_t)bits) +
+           __builtin_popcountll((uint64_t)(bits >> 64));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// A set of N squares stored in one word, with the interface of std::bitset.
+template <typename Word, int N>
+class Bitboard {
+    static constexpr Word MASK =
+        (N == 8 * sizeof(Word)) ? ~Word(0) : (Word(1) << N) - 1;
+
+    Word m_bits = 0;
+
+    // wraps bits already known to lie within the set
+    struct Raw {};
+    constexpr Bitboard(Word bits, Raw) : m_bits(bits) {}
+
+public:
+    constexpr Bitboard() = default;
+    constexpr Bitboard(Word bits) : m_bits(bits & MASK) {}
+
+    // single squares
+    constexpr bool test(int sq) const {
+        return (m_bits >> sq) & 1;
+    }
+    constexpr Bitboard &set(int sq) {
+        m_bits |= Word(1) << sq;
+        return *this;
+    }
+    constexpr Bitboard &reset(int sq) {
+        m_bits &= ~(Word(1) << sq);
+        return *this;
+    }
+
+    // the whole set
+    constexpr bool any() const { return m_bits != 0; }
+    constexpr bool none() const { return m_bits == 0; }
+    int count() const { return count_bits(m_bits); }
+    constexpr Word word() const { return m_bits; }
+    constexpr uint64_t to_ullong() const { return (uint64_t)m_bits; }
+    static constexpr int size() { return N; }
+
+    // set operations
+    constexpr Bitboard operator~() const { return Bitboard(~m_bits); }
+    constexpr Bitboard operator&(const Bitboard &o) const {
+        return Bitboard(m_bits & o.m_bits, Raw {});
+    }
+    constexpr Bitboard operator|(const Bitboard &o) const {
+        return Bitboard(m_bits | o.m_bits, Raw {});
+    }
+    constexpr Bitboard operator^(const Bitboard &o) const {
+        return Bitboard(m_bits ^ o.m_bits, Raw {});
+    }
+    constexpr Bitboard operator<<(int n) const {
+        return Bitboard(m_bits << n);
+    }
+    constexpr Bitboard operator>>(int n) const {
+        return Bitboard(m_bits >> n, Raw {});
+    }
+
+    constexpr Bitboard &operator&=(const Bitboard &o) {
+        m_bits &= o.m_bits;
+        return *this;
+    }
+    constexpr Bitboard &operator|=(const Bitboard &o) {
+        m_bits |= o.m_bits;
+        return *this;
+    }
+    constexpr Bitboard &operator^=(const Bitboard &o) {
+        m_bits ^= o.m_bits;
+        return *this;
+    }
+
+    constexpr bool operator==(const Bitboard &o) const {
+        return m_bits == o.m_bits;
+    }
+    constexpr bool operator!=(const Bitboard &o) const {
+        return m_bits != o.m_bits;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Finds the first bit of a row in the padded layout (rows count from black).
+constexpr int row_base(int half, int row) {
+    return (half + 1) + (2 * half + 1) * (row / 2) + (half + 1) * (row % 2);
+}
+
+// Finds the squares of rows [first, last) in the padded layout.
+template <typename Position>
+constexpr Position row_mask(int half, int first, int last) {
+    Position mask {};
+    for (int row = first; row < last; ++row) {
+        for (int i = 0; i < half; ++i) {
+            mask.set(row_base(half, row) + i);
+        }
+    }
+    return mask;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The padded layout of a WIDTH x HEIGHT board, played on the dark squares.
+template <int W, int H>
+struct Geometry {
+    static constexpr int WIDTH = W;
+    static constexpr int HEIGHT = H;
+
+    // playable squares per row, and in total
+    static constexpr int HALF = W / 2;
+    static constexpr int SQUARES = HALF * H;
+
+    // offsets between cornerwise squares
+    static constexpr int NW = HALF;
+    static constexpr int NE = HALF + 1;
+    static constexpr int SW = -(HALF + 1);
+    static constexpr int SE = -HALF;
+
+    // the directions in table order (see Neighbors): north first
+    static constexpr int DIRS[4] {NW, NE, SW, SE};
+
+    // bits needed, with a row of padding at either end
+    static constexpr int SIZE = row_base(HALF, H) + HALF + 1;
+
+    // the smallest word that fits the layout
+    using Word = std::conditional_t<SIZE <= 64, uint64_t, uint128_t>;
+    using Position = Bitboard<Word, SIZE>;
+
+    // each side fills the rows nearest it, leaving two empty rows between
+    static constexpr int START_ROWS = (H - 2) / 2;
+
+    // most legal actions a side can have: at most four per piece, and four
+    // onto (or over) each square not holding one, so half of 4 x SQUARES
+    static constexpr int MAX_ACTIONS = 2 * SQUARES;
+
+    // promotion squares for black, white pieces
+    static constexpr Position TOP_ROW = row_mask<Position>(HALF, H - 1, H);
+    static constexpr Position BOT_ROW = row_mask<Position>(HALF, 0, 1);
+
+    // the set of all squares a piece can occupy
+    static constexpr Position ON_BOARD = row_mask<Position>(HALF, 0, H);
+
+    // starting squares for black, white pieces
+    static constexpr Position BLACK_START =
+        row_mask<Position>(HALF, 0, START_ROWS);
+    static constexpr Position WHITE_START =
+        row_mask<Position>(HALF, H - START_ROWS, H);
+
+    // finds the first square of a row
+    static constexpr int base(int row) { return row_base(HALF, row); }
+};
+
+// Cornerwise neighbors of one square, indexed as Geometry::DIRS. A jump
+// passes over the step square and lands on the jump square. A step or jump
+// that would leave the board points at OFF_BOARD, which is never occupied or
+// open, so the tables can be used without bounds checks.
+struct Neighbors {
+    int8_t step[4];
+    int8_t jump[4];
+};
+
+constexpr int OFF_BOARD = 0;
+
+// Neighbors of every square of a geometry (off-board squares lead nowhere).
+template <typename G>
+struct NeighborTable {
+    Neighbors square[G::SIZE];
+
+    constexpr const Neighbors &operator[](int sq) const { return square[sq]; }
+};
+
+template <typename G>
+constexpr NeighborTable<G> make_neighbors() {
+    NeighborTable<G> table {};
+    for (int sq = 0; sq < G::SIZE; ++sq) {
+        for (int i = 0; i < 4; ++i) {
+            const int step = sq + G::DIRS[i];
+            const int jump = sq + 2 * G::DIRS[i];
+            const bool from = G::ON_BOARD.test(sq);
+            const bool step_on = from && step >= 0 && step < G::SIZE &&
+                                 G::ON_BOARD.test(step);
+            const bool jump_on = step_on && jump >= 0 && jump < G::SIZE &&
+                                 G::ON_BOARD.test(jump);
+            table.square[sq].step[i] = step_on ? step : OFF_BOARD;
+            table.square[sq].jump[i] = jump_on ? jump : OFF_BOARD;
+        }
+    }
+    return table;
+}
+
+// Built at compile time, so a per-square query is a few table loads.
+template <typename G>
+constexpr NeighborTable<G> NEIGHBORS = make_neighbors<G>();
+
+////////////////////////////////////////////////////////////////////////////////
+
+// English draughts, and the 10x10 board of international draughts.
+using EnglishGeometry = Geometry<8, 8>;
+using Geometry10x10 = Geometry<10, 10>;
+
+static_assert(EnglishGeometry::SIZE == 46, "8x8 layout must stay 46 bits");
+static_assert(sizeof(EnglishGeometry::Word) == 8, "8x8 fits one 64-bit word");
+static_assert(sizeof(Geometry10x10::Word) == 16,
+              "10x10 needs 128 bits");
+
+// Square 5 (bottom left) steps NE to 10 and jumps to 15, and has no NW.
+static_assert(NEIGHBORS<EnglishGeometry>[5].step[1] == 10 &&
+              NEIGHBORS<EnglishGeometry>[5].jump[1] == 15 &&
+              NEIGHBORS<EnglishGeometry>[5].step[0] == OFF_BOARD,
+              "8x8 neighbor table must match the board.hh layout");
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,97 @@
+/* -----------------------------------------------------------------------------
+pdn.hh
+
+Provides Portable Draughts Notation (PDN) import and export by:
+    1. converting between PDN square numbers (1-32) and board squares
+    2. converting positions to and from FEN strings ("B:W21,22,K30:B1,2")
+    3. streaming games in and out of PDN text one game at a time
+
+PDN numbering (black starts on 1-12 and moves first):
+    xx 32 xx 31 xx 30 xx 29
+    28 xx 27 xx 26 xx 25 xx
+    ...
+    xx 08 xx 07 xx 06 xx 05
+    04 xx 03 xx 02 xx 01 xx
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#ifndef PDN_HH
+#define PDN_HH
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "engine/board.hh"
+#include "engine/record.hh"
+
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Converts between PDN square numbers and board squares (-1 if invalid).
+int pdn_to_square(int num);
+int square_to_pdn(int sq);
+
+// Writes a single action as a PDN move ("11-15" or "15x24").
+std::string write_action(const Action &action);
+
+// Converts between positions and FEN strings.
+int parse_fen(const std::string &fen, Board &state);
+std::string write_fen(const Board &state);
+
+////////////////////////////////////////////////////////////////////////////////
+
+class PdnReader {
+    std::istream &m_in;
+
+    // a tag read past the end of the previous game
+    std::string m_pending_tag;
+
+public:
+    PdnReader(std::istream &in);
+
+    // reads the next game, returning false at the end of the stream; a game
+    // with a bad move is still read to its end, and marked with Game::error
+    bool next(Game &game);
+
+private:
+    // reads the next movetext token, or tag into "tag", skipping comments
+    bool next_token(std::string &token, std::string &tag);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class PdnWriter {
+    std::ostream &m_out;
+
+public:
+    PdnWriter(std::ostream &out);
+
+    // writes one game with its result and, if needed, its FEN
+    void write(const Game &game);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Streams games from either a ".pdn" file or a binary record file.
+class GameSource {
+    std::ifstream m_text;
+    std::unique_ptr<PdnReader> m_pdn;
+    GameReader m_record;
+
+public:
+    // opens a file by its extension (returns ACTION_SUCCESS or ACTION_FAILURE)
+    int open(const std::string &path);
+
+    // reads the next game, returning false at the end of the file
+    bool next(Game &game);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,134 @@
+/* -----------------------------------------------------------------------------
+record.hh
+
+Provides a compact binary format for storing many games by:
+    1. defining a "Game" as a starting Board, its History and a result
+    2. encoding each action as its index in the list of legal actions
+    3. streaming games to and from a file one at a time (GameWriter/Reader)
+
+File layout:
+    file header     magic "CKGR", version
+    game records    GameHeader, [start position], one byte per action
+    index           file offset of every game record
+    footer          index offset, game count, magic "CKGR"
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#ifndef RECORD_HH
+#define RECORD_HH
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "engine/board.hh"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Identifies a game record file and its layout version.
+const char RECORD_MAGIC[4] {'C', 'K', 'G', 'R'};
+const uint32_t RECORD_VERSION {1};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The outcome of a game.
+enum Result {UNKNOWN, BLACK_WIN, WHITE_WIN, DRAW};
+
+// A complete game: where it started, every action and how it ended.
+struct Game {
+    Board start;
+    History history;
+    Result result = UNKNOWN;
+
+    // set when a move could not be read; the history stops before it
+    bool error = false;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Leads every game record.
+struct GameHeader {
+    uint8_t result;
+    uint8_t flags;
+    uint16_t plies;
+};
+
+// Set in GameHeader::flags when the game has a custom starting position.
+const uint8_t CUSTOM_START {0x01};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Finds the index of an action among the side to move's legal actions.
+int encode_action(const Board &state, const Action &action);
+
+// Applies the legal action with the given index to a board.
+int decode_action(Board &state, int index);
+
+////////////////////////////////////////////////////////////////////////////////
+
+class GameWriter {
+    FILE *m_file = nullptr;
+
+    // offset of each written game, flushed as the index on close
+    std::vector<uint64_t> m_offsets;
+    
+public:
+    GameWriter() = default;
+    ~GameWriter();
+    GameWriter(const GameWriter &) = delete;
+    GameWriter &operator=(const GameWriter &) = delete;
+
+    // creates a record file (returns ACTION_SUCCESS or ACTION_FAILURE)
+    int open(const std::string &path);
+    int close();
+
+    // appends one game
+    int write(const Game &game);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class GameReader {
+    FILE *m_file = nullptr;
+
+    // where game records end (the index), and how many there are
+    uint64_t m_end = 0;
+    uint64_t m_count = 0;
+    bool m_indexed = false;
+
+    // games read since the start of the file, or the last seek
+    uint64_t m_read = 0;
+
+    // raw actions of the game being read
+    std::vector<uint8_t> m_buffer;
+
+public:
+    GameReader() = default;
+    ~GameReader();
+    GameReader(const GameReader &) = delete;
+    GameReader &operator=(const GameReader &) = delete;
+
+    // opens a record file (returns ACTION_SUCCESS or ACTION_FAILURE)
+    int open(const std::string &path);
+    void close();
+
+    // reads the next game, returning false at the end of the file; a game
+    // that does not replay is kept up to its bad action, and marked with
+    // Game::error
+    bool next(Game &game);
+
+    // jumps to the n-th game using the index (indexed files only)
+    int seek(uint64_t n);
+
+    // number of games, known only when the file has an index
+    uint64_t size() const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,62 @@
+/* -----------------------------------------------------------------------------
+thread_pool.hh
+
+Provides a fixed set of worker threads fed from a bounded job queue. The queue
+bound makes "submit" block, so a producer streaming input can never run far
+ahead of the workers.
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#ifndef THREAD_POOL_HH
+#define THREAD_POOL_HH
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+class ThreadPool {
+    std::vector<std::thread> m_workers;
+
+    // pending jobs and the number of jobs not yet finished
+    std::deque<std::function<void()>> m_jobs;
+    size_t m_capacity;
+    size_t m_unfinished = 0;
+    bool m_stopping = false;
+
+    std::mutex m_mutex;
+    std::condition_variable m_job_ready;
+    std::condition_variable m_job_taken;
+    std::condition_variable m_all_done;
+
+public:
+    // threads = 0 uses one thread per hardware core
+    ThreadPool(unsigned threads = 0, size_t capacity = 1024);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // queues a job, blocking while the queue is full
+    void submit(std::function<void()> job);
+
+    // blocks until every submitted job has finished
+    void wait();
+
+    // number of worker threads
+    unsigned size() const;
+
+private:
+    void work();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
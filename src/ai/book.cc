@@ -0,0 +1,223 @@
+/* -----------------------------------------------------------------------------
+book.cc
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "ai/book.hh"
+#include "engine/board.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////
+
+Book::~Book() {
+    close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int Book::open(const std::string &path) {
+    close();
+
+    // open the file and find its size
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return ACTION_FAILURE;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BookHeader)) {
+        ::close(fd);
+        return ACTION_FAILURE;
+    }
+
+    // map the whole file; the mapping outlives the descriptor
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return ACTION_FAILURE;
+    }
+
+    // validate the header against the file size
+    const BookHeader *header = static_cast<const BookHeader *>(data);
+    const size_t expected = sizeof(BookHeader) + header->count * sizeof(BookEntry);
+    if (std::memcmp(header->magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) != 0 ||
+        header->version != BOOK_VERSION || expected != (size_t)st.st_size) {
+
+        munmap(data, st.st_size);
+        return ACTION_FAILURE;
+    }
+
+    m_data = data;
+    m_size = st.st_size;
+    m_entries = reinterpret_cast<const BookEntry *>(header + 1);
+    m_count = header->count;
+
+    return ACTION_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Book::close() {
+    if (m_data) {
+        munmap(m_data, m_size);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_entries = nullptr;
+    m_count = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+uint64_t Book::size() const {
+    return m_count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::pair<const BookEntry *, const BookEntry *> Book::find(uint64_t key) const {
+    const BookEntry *first = m_entries;
+    const BookEntry *last = m_entries + m_count;
+
+    // entries are sorted by key, so binary search for the key's range
+    first = std::lower_bound(first, last, key,
+        [](const BookEntry &e, uint64_t k) { return e.key < k; });
+    last = std::upper_bound(first, last, key,
+        [](uint64_t k, const BookEntry &e) { return k < e.key; });
+
+    return {first, last};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Plays a book entry's action, writing the resulting position; an entry that
+// is illegal here comes from a key collision.
+static bool play_entry(const Board &state, const BookEntry &entry, Board &result) {
+    const Action action {state.get_turn(), action_type(entry.src, entry.dst),
+                         entry.src, entry.dst, false};
+    result = state;
+    return result.player_action(action) == ACTION_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool Book::probe(const Board &state, std::mt19937 &gen, Board &result) const {
+    if (m_count == 0) {
+        return false;
+    }
+
+    const auto range = find(state.get_key());
+
+    // total weight of the candidate actions, skipping any that are illegal
+    Board next;
+    uint64_t total = 0;
+    for (auto e = range.first; e != range.second; ++e) {
+        if (e->weight > 0 && play_entry(state, *e, next)) {
+            total += e->weight;
+        }
+    }
+
+    if (total == 0) {
+        return false;
+    }
+
+    // pick one action with probability proportional to its weight
+    std::uniform_int_distribution<uint64_t> dist(0, total - 1);
+    uint64_t pick = dist(gen);
+    for (auto e = range.first; e != range.second; ++e) {
+        if (e->weight == 0 || !play_entry(state, *e, next)) {
+            continue;
+        }
+        if (pick >= e->weight) {
+            pick -= e->weight;
+            continue;
+        }
+        result = next;
+        return true;
+    }
+
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BookBuilder::BookBuilder(int max_plies) {
+    m_max_plies = max_plies;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void BookBuilder::add_game(const History &history, int winner) {
+    Board board;
+
+    // replay the opening, crediting each action by the game's outcome
+    const int plies = std::min<int>(history.size(), m_max_plies);
+    for (int i = 0; i < plies; ++i) {
+        const Action &action = history[i];
+
+        // wins count double, draws once, losses not at all
+        const uint32_t weight = (winner == action.color) ? 2 : (winner < 0);
+        const uint64_t key = board.get_key();
+
+        if (board.player_action(action) != ACTION_SUCCESS) {
+            return;
+        }
+
+        if (weight > 0) {
+            const uint16_t move = (action.src << 8) | action.dst;
+            m_weights[{key, move}] += weight;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int BookBuilder::write(const std::string &path) const {
+
+    // map iteration order is already sorted by key
+    std::vector<BookEntry> entries;
+    entries.reserve(m_weights.size());
+    for (const auto &w : m_weights) {
+        BookEntry entry {};
+        entry.key = w.first.first;
+        entry.src = w.first.second >> 8;
+        entry.dst = w.first.second & 0xFF;
+        entry.weight = w.second;
+        entries.push_back(entry);
+    }
+
+    FILE *file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return ACTION_FAILURE;
+    }
+
+    BookHeader header {};
+    std::memcpy(header.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+    header.version = BOOK_VERSION;
+    header.count = entries.size();
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    if (!entries.empty()) {
+        ok = ok && std::fwrite(entries.data(), sizeof(BookEntry),
+                               entries.size(), file) == entries.size();
+    }
+
+    ok = (std::fclose(file) == 0) && ok;
+    return ok ? ACTION_SUCCESS : ACTION_FAILURE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
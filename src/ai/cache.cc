@@ -0,0 +1,258 @@
+/* -----------------------------------------------------------------------------
+cache.cc
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "ai/cache.hh"
+#include "ai/evaluate.hh"
+#include "engine/board.hh"
+
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Slot data layout, from the low bit:
+//     score (32 bits), depth (8), bound (2), used (1), generation (6),
+//     source square (7), destination square (7)
+const int DEPTH_SHIFT {32};
+const int BOUND_SHIFT {40};
+const int USED_SHIFT {42};
+const int AGE_SHIFT {43};
+const int SRC_SHIFT {49};
+const int DST_SHIFT {56};
+
+// Generations wrap at 64.
+const uint32_t AGE_MASK {0x3F};
+
+////////////////////////////////////////////////////////////////////////////////
+
+uint64_t pack_entry(const CacheEntry &entry, uint32_t generation) {
+    uint32_t score;
+    std::memcpy(&score, &entry.score, sizeof(score));
+
+    const uint64_t depth = (entry.depth < 0) ? 0 :
+                           (entry.depth > 0xFF) ? 0xFF : entry.depth;
+
+    return (uint64_t)score |
+           depth << DEPTH_SHIFT |
+           (uint64_t)(entry.bound & 0x3) << BOUND_SHIFT |
+           (uint64_t)1 << USED_SHIFT |
+           (uint64_t)(generation & AGE_MASK) << AGE_SHIFT |
+           (uint64_t)(entry.src & 0x7F) << SRC_SHIFT |
+           (uint64_t)(entry.dst & 0x7F) << DST_SHIFT;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+CacheEntry unpack_entry(uint64_t data) {
+    CacheEntry entry;
+
+    const uint32_t score = (uint32_t)data;
+    std::memcpy(&entry.score, &score, sizeof(score));
+
+    entry.depth = (data >> DEPTH_SHIFT) & 0xFF;
+    entry.bound = (Bound)((data >> BOUND_SHIFT) & 0x3);
+    entry.src = (data >> SRC_SHIFT) & 0x7F;
+    entry.dst = (data >> DST_SHIFT) & 0x7F;
+
+    return entry;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Slots are shared with other processes, so every access is a single atomic
+// word; the key check catches a slot whose two words came from different
+// writers.
+uint64_t load_word(const uint64_t &word) {
+    return __atomic_load_n(&word, __ATOMIC_RELAXED);
+}
+
+void store_word(uint64_t &word, uint64_t value) {
+    __atomic_store_n(&word, value, __ATOMIC_RELAXED);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+AnalysisCache::~AnalysisCache() {
+    close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int AnalysisCache::open(const std::string &path, size_t megabytes) {
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return ACTION_FAILURE;
+    }
+
+    // only one process at a time may check or create the header
+    if (flock(fd, LOCK_EX) != 0) {
+        ::close(fd);
+        return ACTION_FAILURE;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        flock(fd, LOCK_UN);
+        ::close(fd);
+        return ACTION_FAILURE;
+    }
+
+    // an existing file is kept as it is, whatever size was asked for, but
+    // only if it is a cache scored under the weights in use; anything else
+    // is refused, never overwritten
+    const uint64_t fingerprint = weights_fingerprint();
+    CacheHeader header {};
+    bool valid = st.st_size == 0 || (
+        pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+        std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+        header.version == CACHE_VERSION &&
+        header.fingerprint == fingerprint &&
+        (size_t)st.st_size ==
+            sizeof(CacheHeader) + header.buckets * sizeof(CacheBucket));
+
+    // a new (empty) file is laid out as an empty cache, with a power of two
+    // of buckets
+    if (valid && st.st_size == 0) {
+        uint64_t buckets = 1;
+        while (buckets * 2 * sizeof(CacheBucket) <= (megabytes << 20)) {
+            buckets *= 2;
+        }
+
+        header = CacheHeader {};
+        std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header.version = CACHE_VERSION;
+        header.buckets = buckets;
+        header.fingerprint = fingerprint;
+
+        const size_t bytes =
+            sizeof(CacheHeader) + buckets * sizeof(CacheBucket);
+        valid = ftruncate(fd, bytes) == 0 &&
+                pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+    }
+
+    const size_t size =
+        sizeof(CacheHeader) + header.buckets * sizeof(CacheBucket);
+    void *data = valid
+        ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+        : MAP_FAILED;
+
+    flock(fd, LOCK_UN);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return ACTION_FAILURE;
+    }
+
+    // warm start: fault the saved entries in ahead of the first searches
+    madvise(data, size, MADV_WILLNEED);
+
+    // every open begins a new generation, so older entries age
+    CacheHeader *mapped = static_cast<CacheHeader *>(data);
+    m_generation = __atomic_add_fetch(&mapped->generation, 1, __ATOMIC_RELAXED);
+
+    m_data = data;
+    m_size = size;
+    m_buckets = reinterpret_cast<CacheBucket *>(mapped + 1);
+    m_count = header.buckets;
+
+    return ACTION_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void AnalysisCache::close() {
+    if (m_data) {
+        munmap(m_data, m_size);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_buckets = nullptr;
+    m_count = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+uint64_t AnalysisCache::size() const {
+    return m_count * 4;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool AnalysisCache::probe(uint64_t key, CacheEntry &entry) const {
+    if (m_count == 0) {
+        return false;
+    }
+
+    const CacheBucket &bucket = m_buckets[key & (m_count - 1)];
+    for (const CacheSlot &slot : bucket.slots) {
+        const uint64_t data = load_word(slot.data);
+        const uint64_t check = load_word(slot.check);
+        if ((check ^ data) == key && (data >> USED_SHIFT & 1)) {
+            entry = unpack_entry(data);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void AnalysisCache::store(uint64_t key, const CacheEntry &entry) {
+    if (m_count == 0) {
+        return;
+    }
+
+    CacheBucket &bucket = m_buckets[key & (m_count - 1)];
+
+    // prefer the slot already holding this key, else the least valuable one:
+    // empty, then shallowest, with each generation of age costing two plies
+    CacheSlot *victim = nullptr;
+    int victim_value = 0;
+    for (CacheSlot &slot : bucket.slots) {
+        const uint64_t data = load_word(slot.data);
+        const uint64_t check = load_word(slot.check);
+
+        if ((check ^ data) == key && (data >> USED_SHIFT & 1)) {
+
+            // keep a deeper result for the same position
+            const int depth = (data >> DEPTH_SHIFT) & 0xFF;
+            if (depth > entry.depth) {
+                return;
+            }
+            victim = &slot;
+            break;
+        }
+
+        int value = -1000;
+        if (data >> USED_SHIFT & 1) {
+            const int depth = (data >> DEPTH_SHIFT) & 0xFF;
+            const uint32_t age =
+                (m_generation - (data >> AGE_SHIFT)) & AGE_MASK;
+            value = depth - 2 * (int)age;
+        }
+        if (!victim || value < victim_value) {
+            victim = &slot;
+            victim_value = value;
+        }
+    }
+
+    // data first, so a reader racing this write sees a failed key check
+    const uint64_t data = pack_entry(entry, m_generation);
+    store_word(victim->data, data);
+    store_word(victim->check, key ^ data);
+}
+
+////////////////////////////////////////////////////////////////////////////////
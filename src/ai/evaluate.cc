@@ -0,0 +1,211 @@
+/* -----------------------------------------------------------------------------
+evaluate.cc
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "ai/evaluate.hh"
+#include "ai/stats.hh"
+#include "engine/board.hh"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Squares of each row, from black's back rank (0) to white's (7).
+const Position ROWS[8] {
+    0x000000001E0, 0x00000003C00, 0x0000003C000, 0x00000780000,
+    0x00007800000, 0x000F0000000, 0x00F00000000, 0x1E000000000
+};
+
+// The eight central squares.
+const Position CENTER_SQUARES {0x00063318000};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Weights used by the engine.
+static Weights s_weights;
+
+////////////////////////////////////////////////////////////////////////////////
+
+const Weights &get_weights() {
+    return s_weights;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void set_weights(const Weights &weights) {
+    s_weights = weights;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+uint64_t weights_fingerprint() {
+
+    // FNV-1a over the feature count and each weight's bits
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    const auto mix = [&hash](uint32_t word) {
+        for (int byte = 0; byte < 4; ++byte) {
+            hash = (hash ^ ((word >> (8 * byte)) & 0xFF)) * 0x100000001B3ULL;
+        }
+    };
+
+    mix(NUM_FEATURES);
+    for (const float weight : s_weights.w) {
+        uint32_t bits;
+        std::memcpy(&bits, &weight, sizeof(bits));
+        mix(bits);
+    }
+    return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int load_weights(const std::string &path, Weights &weights) {
+    std::ifstream in(path);
+    if (!in) {
+        return ACTION_FAILURE;
+    }
+
+    // read "name value" pairs, leaving unnamed features unchanged
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        float value;
+        if (!(fields >> name) || name[0] == '#') {
+            continue;
+        }
+        if (!(fields >> value)) {
+            return ACTION_FAILURE;
+        }
+
+        int f = 0;
+        while (f < NUM_FEATURES && name != FEATURE_NAMES[f]) ++f;
+        if (f == NUM_FEATURES) {
+            return ACTION_FAILURE;
+        }
+        weights.w[f] = value;
+    }
+
+    return ACTION_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int save_weights(const std::string &path, const Weights &weights) {
+    FILE *file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        return ACTION_FAILURE;
+    }
+
+    for (int f = 0; f < NUM_FEATURES; ++f) {
+        std::fprintf(file, "%s %.6f\n", FEATURE_NAMES[f], weights.w[f]);
+    }
+
+    return (std::fclose(file) == 0) ? ACTION_SUCCESS : ACTION_FAILURE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void get_features(const Board &state, int8_t features[NUM_FEATURES]) {
+    const Position black_men = state.get_black() & ~state.get_kings();
+    const Position white_men = state.get_white() & ~state.get_kings();
+    const Position black_kings = state.get_black() & state.get_kings();
+    const Position white_kings = state.get_white() & state.get_kings();
+
+    // material
+    features[MEN] = (int)black_men.count() - (int)white_men.count();
+    features[KINGS] = (int)black_kings.count() - (int)white_kings.count();
+
+    // men guarding their own back rank
+    features[BACK_RANK] = (int)(black_men & ROWS[0]).count() -
+                          (int)(white_men & ROWS[7]).count();
+
+    // pieces holding the center
+    features[CENTER] = (int)(state.get_black() & CENTER_SQUARES).count() -
+                       (int)(state.get_white() & CENTER_SQUARES).count();
+
+    // rows advanced by men toward promotion
+    int advance = 0;
+    for (int row = 1; row < 7; ++row) {
+        advance += row * (int)(black_men & ROWS[row]).count();
+        advance -= (7 - row) * (int)(white_men & ROWS[row]).count();
+    }
+    features[ADVANCE] = advance;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+float evaluate(const Board &state) {
+    return evaluate(state, s_weights);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+float evaluate(const Board &state, const Weights &weights) {
+    STATS_ADD(leaf_evals, 1);
+
+    int8_t features[NUM_FEATURES];
+    get_features(state, features);
+
+    float eval = 0;
+    for (int f = 0; f < NUM_FEATURES; ++f) {
+        eval += weights.w[f] * features[f];
+    }
+
+    return eval;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Minimaxes over takes only, returning the evaluation and its quiet leaf.
+float quiesce(const Board &state, const Weights &weights, Board &leaf) {
+    STATS_ADD(quiescence_nodes, 1);
+    STATS_ADD(movegen_calls, 1);
+
+    // left uninitialized: every board the generator writes is a full copy
+    alignas(Board) unsigned char storage[sizeof(Board) * Board::MAX_ACTIONS];
+    Board *actions = reinterpret_cast<Board *>(storage);
+    const Color turn = state.get_turn();
+    const int count = state.get_actions(turn, actions);
+
+    // takes are forced, so a position is quiet when the first action is not
+    if (count == 0 || actions[0].get_last_action().type != TAKE) {
+        leaf = state;
+        return evaluate(state, weights);
+    }
+
+    float best = 0;
+    for (int i = 0; i < count; ++i) {
+        Board child_leaf;
+        const float eval = quiesce(actions[i], weights, child_leaf);
+
+        // black maximizes, white minimizes
+        if (i == 0 || (turn == BLACK && eval > best) ||
+            (turn == WHITE && eval < best)) {
+
+            best = eval;
+            leaf = child_leaf;
+        }
+    }
+
+    return best;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Board quiesce(const Board &state, const Weights &weights) {
+    Board leaf;
+    quiesce(state, weights, leaf);
+    return leaf;
+}
+
+////////////////////////////////////////////////////////////////////////////////
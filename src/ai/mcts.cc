@@ -0,0 +1,437 @@
+/* -----------------------------------------------------------------------------
+mcts.cc
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "ai/mcts.hh"
+#include "ai/evaluate.hh"
+#include "ai/stats.hh"
+#include "ai/trace.hh"
+#include "engine/board.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Exploration constant of the PUCT formula.
+const float PUCT_C {1.5};
+
+// Losses added to a node while a thread is searching below it.
+const int VIRTUAL_LOSS {3};
+
+// Fixed-point scale of node values.
+const double VALUE_SCALE {1e6};
+
+// Simulations per unit of search depth when no other limit is given.
+const long SIMULATIONS_PER_DEPTH {2000};
+
+// Converts evaluations (in men) to values and priors.
+const float VALUE_SLOPE {0.5};
+const float PRIOR_SLOPE {2.0};
+
+// Random playouts longer than this are scored by evaluation.
+const int PLAYOUT_PLIES {150};
+
+// Room each thread's selection path starts with, so a tree grown deeper in
+// one search than the last does not allocate mid-search.
+const size_t PATH_RESERVE {256};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Writes the legal actions of the side to move to "actions" (room for
+// Board::MAX_ACTIONS), returning how many there are.
+static int get_actions(const Board &state, Color turn, Board *actions) {
+    STATS_ADD(movegen_calls, 1);
+    return state.get_actions(turn, actions);
+}
+
+// Converts a value back to an evaluation (in men), undoing the squashing
+// of "Mcts::value", so scores compare with MinMax's (a value of exactly 1 or
+// -1 is a game won or lost outright).
+static float value_to_eval(double value) {
+    if (value >= 1 || value <= -1) {
+        return (value > 0) ? LOSS_EVAL : -LOSS_EVAL;
+    }
+    return std::atanh(value) / VALUE_SLOPE;
+}
+
+// Resets an arena slot to a fresh leaf.
+static void init_node(MctsNode &node, Board state, float prior) {
+    node.state = std::move(state);
+    node.turn = node.state.get_turn();
+    node.prior = prior;
+    node.first_child = 0;
+    node.num_children = 0;
+    node.expansion.store(UNEXPANDED, std::memory_order_relaxed);
+    node.visits.store(0, std::memory_order_relaxed);
+    node.value.store(0, std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Mcts::Mcts(Color playing_for, int search_depth, unsigned threads,
+           bool playouts, uint32_t capacity) {
+    m_playing_for = playing_for;
+    m_search_depth = search_depth;
+    m_threads = std::max(1u, threads);
+    m_playouts = playouts;
+    m_capacity = capacity;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Mcts::~Mcts() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_round_start.notify_all();
+    for (auto &helper : m_helpers) {
+        helper.join();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Board Mcts::best_move(const Board &state) {
+
+    // answer straight from the opening book when it covers the position
+    Board book_move;
+    if (probe_book(state, book_move)) {
+        return book_move;
+    }
+
+    const SearchResult result = search(state, Limits {m_search_depth});
+    return result.pv.empty() ? state : result.best;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SearchResult Mcts::search(const Board &state, const Limits &limits) {
+
+    // without a node or time limit, the budget scales with the depth
+    const bool timed = limits.seconds > 0;
+    m_budget = (limits.nodes > 0) ? limits.nodes :
+               timed ? LONG_MAX : std::max(1, limits.depth) * SIMULATIONS_PER_DEPTH;
+
+    // size the arena once; each simulation adds at most one node's children
+    const uint32_t needed = timed ? m_capacity
+                                  : std::min<long>(m_budget * 16 + 1, m_capacity);
+    if (needed > m_allocated) {
+        m_arena.reset(new MctsNode[needed]);
+        m_allocated = needed;
+    }
+
+    init_node(m_arena[0], state, 1.0);
+    m_size = 1;
+    m_simulations = 0;
+    thread_stats().clear();
+    m_stats.clear();
+    TRACE_EVENT(SEARCH_BEGIN, 0, limits.depth);
+
+    // every thread simulates on the same tree; the helpers are started once
+    // and then woken for each search
+    while (m_helpers.size() + 1 < m_threads) {
+        m_helpers.emplace_back(&Mcts::help, this);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_seconds = limits.seconds;
+        m_busy = m_helpers.size();
+        ++m_round;
+    }
+    m_round_start.notify_all();
+
+    work(limits.seconds);
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_round_done.wait(lock, [this] { return m_busy == 0; });
+    }
+
+    // the root is expanded even if no simulation got to it (no time, or a
+    // full arena), so there is always a legal action to fall back on
+    MctsNode &root = m_arena[0];
+    uint8_t expansion = root.expansion.load(std::memory_order_acquire);
+    if (expansion == UNEXPANDED &&
+        root.expansion.compare_exchange_strong(expansion, EXPANDING)) {
+
+        expand(0);
+    }
+
+    // follow the most visited children for the best action and PV, which is
+    // measured first so it is allocated once
+    SearchResult result {state, 0, {}, 0, 0, {}};
+    size_t length = 1;
+    for (const MctsNode *node = best_child(root); node; node = best_child(*node)) {
+        ++length;
+    }
+    result.pv.reserve(length);
+
+    for (const MctsNode *node = best_child(root); node; node = best_child(*node)) {
+
+        // the root's best child also gives the score
+        if (result.pv.empty()) {
+            const double q = node->value / VALUE_SCALE / node->visits;
+            result.best = node->state;
+            result.score = value_to_eval((root.turn == BLACK) ? q : -q);
+        }
+
+        result.pv.push_back(node->state.get_last_action());
+    }
+
+    // with no child visited, the one with the highest prior is played
+    if (result.pv.empty() && root.expansion.load() == EXPANDED) {
+        const MctsNode *best = nullptr;
+        for (uint32_t i = 0; i < root.num_children; ++i) {
+            const MctsNode &child = m_arena[root.first_child + i];
+            if (!best || child.prior > best->prior) {
+                best = &child;
+            }
+        }
+        if (best) {
+            result.best = best->state;
+            result.score = evaluate(best->state);
+            result.pv.push_back(best->state.get_last_action());
+        }
+    }
+
+    result.nodes = m_size.load();
+    result.depth = result.pv.size();
+    result.stats = m_stats;
+    result.stats += thread_stats();
+    TRACE_EVENT(SEARCH_END, 0, result.nodes);
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Mcts::help() {
+    uint64_t round = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_round_start.wait(lock, [&] { return m_stopping || m_round != round; });
+        if (m_stopping) {
+            return;
+        }
+        round = m_round;
+        const double seconds = m_seconds;
+        lock.unlock();
+
+        // each round's counters are merged into the search's
+        thread_stats().clear();
+        work(seconds);
+
+        lock.lock();
+        m_stats += thread_stats();
+        if (--m_busy == 0) {
+            m_round_done.notify_one();
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Mcts::work(double seconds) {
+    using Clock = std::chrono::steady_clock;
+    const auto deadline = Clock::now() +
+        std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+
+    // each thread keeps its path across searches, sized up front so it only
+    // grows for a tree deeper than PATH_RESERVE
+    thread_local std::vector<uint32_t> path;
+    if (path.capacity() < PATH_RESERVE) {
+        path.reserve(PATH_RESERVE);
+    }
+    for (long n = 0; m_simulations.fetch_add(1) < m_budget; ++n) {
+
+        // check the clock every so often
+        if (seconds > 0 && (n & 0xF) == 0) {
+            const bool late = Clock::now() > deadline;
+            TRACE_EVENT(TIME_CHECK, 0, late);
+            if (late) {
+                break;
+            }
+        }
+
+        simulate(path);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Mcts::simulate(std::vector<uint32_t> &path) {
+    TRACE_NODE(0, 0);
+    path.clear();
+
+    // descend, adding virtual loss to every node on the way
+    uint32_t index = 0;
+    for (;;) {
+        MctsNode &node = m_arena[index];
+        path.push_back(index);
+        node.visits.fetch_add(VIRTUAL_LOSS);
+        node.value.fetch_sub(VIRTUAL_LOSS * (int64_t)VALUE_SCALE);
+
+        uint8_t expansion = node.expansion.load(std::memory_order_acquire);
+        if (expansion == EXPANDED) {
+            if (node.num_children == 0) break;
+            index = select(index);
+            continue;
+        }
+
+        // claim the node and expand it; a node another thread is expanding,
+        // or that does not fit in the arena, is valued as a leaf
+        if (expansion == UNEXPANDED &&
+            node.expansion.compare_exchange_strong(expansion, EXPANDING)) {
+
+            expand(index);
+        }
+        break;
+    }
+
+    const float leaf = value(m_arena[index]);
+
+    // back up the value for the player who moved into each node
+    for (size_t i = 0; i < path.size(); ++i) {
+        MctsNode &node = m_arena[path[i]];
+        const Color mover = (i == 0) ? (node.turn == BLACK ? WHITE : BLACK)
+                                     : m_arena[path[i - 1]].turn;
+        const float v = (mover == BLACK) ? leaf : -leaf;
+
+        node.visits.fetch_add(1 - VIRTUAL_LOSS);
+        node.value.fetch_add((int64_t)((v + VIRTUAL_LOSS) * VALUE_SCALE));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool Mcts::expand(uint32_t index) {
+    MctsNode &node = m_arena[index];
+
+    // left uninitialized: every board the generator writes is a full copy
+    alignas(Board) unsigned char storage[sizeof(Board) * Board::MAX_ACTIONS];
+    Board *actions = reinterpret_cast<Board *>(storage);
+    const uint32_t count = get_actions(node.state, node.turn, actions);
+    STATS_BRANCHING(count);
+
+    // claim a contiguous block of the arena for the children, never moving
+    // the size past the end (so a full arena stays exactly full)
+    uint32_t first = m_size.load(std::memory_order_relaxed);
+    do {
+        if ((uint64_t)first + count > m_allocated) {
+            node.expansion.store(UNEXPANDED, std::memory_order_release);
+            return false;
+        }
+    } while (!m_size.compare_exchange_weak(first, first + count,
+                                           std::memory_order_relaxed));
+
+    // priors favor children that evaluate well for the side to move; each
+    // child holds its weight until the total is known
+    float total = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        const float eval = evaluate(actions[i]);
+        const float weight =
+            std::exp(PRIOR_SLOPE * ((node.turn == BLACK) ? eval : -eval));
+        init_node(m_arena[first + i], actions[i], weight);
+        total += weight;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        m_arena[first + i].prior /= total;
+    }
+
+    STATS_ADD(nodes, count);
+
+    // publish the children
+    node.first_child = first;
+    node.num_children = count;
+    node.expansion.store(EXPANDED, std::memory_order_release);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const MctsNode *Mcts::best_child(const MctsNode &node) const {
+    if (node.expansion.load() != EXPANDED) {
+        return nullptr;
+    }
+
+    const MctsNode *best = nullptr;
+    for (uint32_t i = 0; i < node.num_children; ++i) {
+        const MctsNode &child = m_arena[node.first_child + i];
+        if (!best || child.visits > best->visits) {
+            best = &child;
+        }
+    }
+
+    return (best && best->visits > 0) ? best : nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+uint32_t Mcts::select(uint32_t index) const {
+    const MctsNode &node = m_arena[index];
+    const float scale = PUCT_C * std::sqrt((float)std::max(1, node.visits.load()));
+
+    uint32_t best = node.first_child;
+    float best_score = -1e9;
+    for (uint32_t i = 0; i < node.num_children; ++i) {
+        const MctsNode &child = m_arena[node.first_child + i];
+        const int visits = child.visits.load(std::memory_order_relaxed);
+        const double value = child.value.load(std::memory_order_relaxed);
+
+        // unvisited children have a neutral value
+        const float q = (visits > 0) ? value / VALUE_SCALE / visits : 0;
+        const float u = scale * child.prior / (1 + visits);
+        if (q + u > best_score) {
+            best_score = q + u;
+            best = node.first_child + i;
+        }
+    }
+
+    return best;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+float Mcts::value(const MctsNode &node) const {
+
+    // a side with no legal action has lost
+    if (node.expansion.load(std::memory_order_acquire) == EXPANDED &&
+        node.num_children == 0) {
+
+        return (node.turn == BLACK) ? -1 : 1;
+    }
+
+    if (!m_playouts) {
+        return std::tanh(VALUE_SLOPE * evaluate(quiesce(node.state, get_weights())));
+    }
+
+    // play random actions until the game ends or runs too long
+    Board state = node.state;
+    alignas(Board) unsigned char storage[sizeof(Board) * Board::MAX_ACTIONS];
+    Board *actions = reinterpret_cast<Board *>(storage);
+    for (int ply = 0; ply < PLAYOUT_PLIES; ++ply) {
+        const Color turn = state.get_turn();
+        const int count = get_actions(state, turn, actions);
+        if (count == 0) {
+            return (turn == BLACK) ? -1 : 1;
+        }
+
+        std::uniform_int_distribution<int> dist(0, count - 1);
+        state = actions[dist(generator())];
+    }
+
+    return std::tanh(VALUE_SLOPE * evaluate(state));
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -1,188 +1,319 @@
-/* -----------------------------------------------------------------------------
-minmax.cc
-
-Name: Joseph Sturm
-Date: 01/27/2020
------------------------------------------------------------------------------ */
-
-#include "ai/minmax.hh"
-#include "engine/board.hh"
-
-#include <random>
-#include <vector>
-
-////////////////////////////////////////////////////////////////////////////////
-
-float rand_int(int min, int max) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<int> dist(min, max);
-    return dist(gen);
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-float evaluate(const Board &state) {
-
-    // difference in piece count (higher better for black)
-    float piece_diff = (float)state.get_black().count() -
-                       (float)state.get_white().count();
-
-    // difference in kings count (higher better for black)
-    float kings_diff = (float)(state.get_black() & state.get_kings()).count() -
-                       (float)(state.get_white() & state.get_kings()).count();
-
-    return piece_diff + (0.25 * kings_diff);
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-MinMax::MinMax(Color playing_for, int search_depth) {
-    m_playing_for = playing_for;
-    m_search_depth = search_depth;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-// Perform the MinMax algorithm to find AI's next move.
-Board MinMax::best_move(const Board &state) {
-
-    // init node from state
-    Node root(state);
-
-    // expand the tree to desired depth
-    expand(root, m_search_depth);
-
-    // propagate values up the tree
-    if (m_playing_for == BLACK) {
-        propagate(root, true).m_state;
-    } else {
-        propagate(root, false).m_state;
-    }
-
-    // get a list of all nodes with optimal value...
-    std::vector<Node> candidates;
-    for (auto &child : root.m_children) {
-        if (child.m_eval == root.m_eval) {
-            candidates.push_back(child);
-        }
-    }
-
-    // ...and return one's state randomly
-    return candidates[rand_int(0, candidates.size() - 1)].m_state;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-// Builds a MinMax tree (of Node: Board and evaluation).
-void MinMax::expand(Node &current, int counter) {
-
-    // terminate if depth limit is reached
-    if (counter-- == 0) return;
-
-    // expand the current node
-    if (m_playing_for == BLACK) {
-        current.find_children(BLACK);
-    } else {
-        current.find_children(WHITE);
-    }
-
-    // loop through all children of current node
-    for (auto &child : current.m_children) {
-
-        // don't expand leaf nodes
-        if (current.m_children.size() == 0) {
-            continue;
-        }
-
-        // expand all children of current node
-        if (m_playing_for == BLACK) {
-            child.find_children(WHITE);
-        } else {
-            child.find_children(BLACK);
-        }
-
-        // recursive call
-        expand(child, counter);
-    }
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-// Propagates Board evaluations up a MinMax tree.
-Node &MinMax::propagate(Node &current, bool maxing) {
-
-    // exit condition: node is leaf node
-    if (current.m_children.size() == 0) {
-        return current;
-    }
-
-    // choose to maximize or minimize 
-    switch (maxing) {
-    case true:
-        // evaluation starts low
-        current.m_eval = -1e6;
-
-        // call "propagate" on each child, set eval to highest
-        for (auto &child : current.m_children) {
-            current.m_eval = max_node(current, propagate(child, false)).m_eval;
-        }
-
-        return current;
-    
-    case false:
-        // evaluation starts high
-        current.m_eval = 1e6;
-
-        // call "propagate" on each child, set eval to lowest
-        for (auto &child : current.m_children) {
-            current.m_eval = min_node(current, propagate(child, true)).m_eval;
-        }
-
-        return current;
-    }
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-// Given two MinMax nodes, returns node with higher evaluation.
-Node MinMax::max_node(const Node &n1, const Node &n2) {
-    if (n2.m_eval > n1.m_eval) return n2;
-    return n1;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-// Given two MinMax nodes, returns node with lower evaluation.
-Node MinMax::min_node(const Node &n1, const Node &n2) {
-    if (n2.m_eval < n1.m_eval) return n2;
-    return n1;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-Node::Node(const Board &state) {
-    m_state = state;
-    m_eval = evaluate(state);
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-// Generates and stores all children of a MinMax node.
-void Node::find_children(Color col) {
-
-    // get child states for the right color
-    std::vector<Board> child_states;
-    if (col == BLACK) {
-        child_states = m_state.get_black_actions();
-    } else {
-        child_states = m_state.get_white_actions();
-    }
-
-    // create child nodes for all child states
-    for (const auto &state : child_states) {
-        m_children.push_back(Node(state));
-    }
-}
-
-////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
+/* -----------------------------------------------------------------------------
+minmax.cc
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "ai/minmax.hh"
+#include "ai/cache.hh"
+#include "ai/evaluate.hh"
+#include "ai/stats.hh"
+#include "ai/trace.hh"
+#include "engine/board.hh"
+#include "engine/draw.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <random>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Evaluation of a drawn position (see draw.hh).
+const float DRAW_EVAL {0};
+
+// Only subtrees at least this deep are worth a cache probe or store.
+const auto CACHE_MIN_DEPTH {3};
+
+////////////////////////////////////////////////////////////////////////////////
+
+MinMax::MinMax(Color playing_for, int search_depth) {
+    m_playing_for = playing_for;
+    m_search_depth = search_depth;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Perform the MinMax algorithm to find AI's next move.
+Board MinMax::best_move(const Board &state) {
+
+    // answer straight from the opening book when it covers the position
+    Board book_move;
+    if (probe_book(state, book_move)) {
+        return book_move;
+    }
+
+    // a fixed-depth search with no time or node limit
+    m_nodes = 0;
+    m_node_limit = 0;
+    m_timed = false;
+    m_aborted = false;
+
+    // search to the desired depth, leaving every root action's value
+    float eval;
+    run(state, m_search_depth, eval);
+    const SearchFrame &root = m_frames[0];
+
+    // count the actions with optimal value...
+    int candidates = 0;
+    for (int i = 0; i < root.count; ++i) {
+        candidates += (root.values[i] == eval);
+    }
+
+    // no legal action: the position is returned unchanged
+    if (candidates == 0) {
+        return state;
+    }
+
+    // ...and return one's state randomly
+    std::uniform_int_distribution<size_t> dist(0, candidates - 1);
+    size_t choice = dist(generator());
+    int i = 0;
+    while (root.values[i] != eval || choice-- > 0) {
+        ++i;
+    }
+    return root.children[i];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Search each depth in turn, keeping the deepest completed iteration.
+SearchResult MinMax::search(const Board &state, const Limits &limits) {
+    using Clock = std::chrono::steady_clock;
+
+    m_nodes = 0;
+    m_node_limit = limits.nodes;
+    m_aborted = false;
+    thread_stats().clear();
+    m_timed = limits.seconds > 0;
+    m_deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(limits.seconds));
+
+    SearchResult result {state, evaluate(state), {}, 0, 0, {}};
+    TRACE_EVENT(SEARCH_BEGIN, 0, limits.depth);
+
+    // find how the root was reached (run does the same before searching)
+    if (state.get_key() != m_game_key) {
+        m_keys.clear();
+    }
+    m_keys.push(state);
+    const bool fresh = m_keys.reversible() == 0;
+    m_keys.pop();
+
+    // a position already searched deep enough is answered from the cache,
+    // unless it was reached reversibly: then it may itself be drawn, or its
+    // actions may repeat the game's earlier positions
+    CacheEntry cached;
+    if (fresh && probe_cache(state, cached) && cached.bound == EXACT &&
+        cached.depth >= limits.depth) {
+
+        // a take spans two diagonal steps, a move only one
+        const Type type = action_type(cached.src, cached.dst);
+        const Action action {state.get_turn(), type, cached.src, cached.dst,
+                             false};
+
+        Board best = state;
+        if (best.player_action(action) == ACTION_SUCCESS) {
+            result.best = best;
+            result.score = cached.score;
+            result.pv.push_back(best.get_last_action());
+            result.depth = cached.depth;
+            result.stats = thread_stats();
+            TRACE_EVENT(SEARCH_END, 0, 0);
+            return result;
+        }
+    }
+
+    // no PV is longer than the search, so iterations never reallocate it
+    const int max_depth = std::min(limits.depth, MAX_SEARCH_DEPTH);
+    result.pv.reserve(std::max(max_depth, 0));
+
+    for (int depth = 1; depth <= max_depth; ++depth) {
+        [[maybe_unused]] const auto iteration_start = Clock::now();
+
+        // an interrupted iteration is discarded (the first always completes)
+        TRACE_EVENT(ITERATION_BEGIN, depth, 0);
+        float eval;
+        const bool complete = run(state, depth, eval);
+        TRACE_EVENT(ITERATION_END, depth, m_nodes);
+        if (!complete && depth > 1) {
+            break;
+        }
+        STATS_DEPTH_TIME(depth, std::chrono::duration<double>(
+            Clock::now() - iteration_start).count());
+
+        const SearchFrame &root = m_frames[0];
+        result.score = eval;
+        result.depth = depth;
+        result.pv.assign(root.pv, root.pv + root.pv_length);
+
+        // the PV begins with the first optimal action
+        for (int i = 0; i < root.count; ++i) {
+            if (root.values[i] == eval) {
+                result.best = root.children[i];
+                break;
+            }
+        }
+
+        // nothing deeper to find once the game is over
+        if (root.count == 0 || m_aborted) {
+            break;
+        }
+    }
+
+    result.nodes = m_nodes;
+    result.stats = thread_stats();
+    TRACE_EVENT(SEARCH_END, 0, m_nodes);
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Searches the root to a depth, returning false if the search was stopped.
+bool MinMax::run(const Board &root, int depth, float &eval) {
+    depth = std::min(depth, MAX_SEARCH_DEPTH);
+
+    // the only allocations of a search: frames for plies not reached before
+    if ((int)m_frames.size() < depth + 1) {
+        m_frames.resize(depth + 1);
+    }
+
+    // the game's earlier positions only count if it led to this root
+    if (root.get_key() != m_game_key) {
+        m_keys.clear();
+    }
+    m_keys.reserve(m_keys.size() + depth + 1);
+
+    m_keys.push(root);
+    m_draw_origin = INT_MAX;
+    eval = (root.get_turn() == BLACK) ? search_node<BLACK>(root, depth, 0)
+                                      : search_node<WHITE>(root, depth, 0);
+    m_keys.pop();
+
+    return !m_aborted;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Searches depth first with C to move, so a position's actions live in its
+// ply's frame only while its subtree is searched.
+template <Color C>
+float MinMax::search_node(const Board &state, int depth, int ply) {
+    constexpr Color OTHER = ColorTraits<C>::OTHER;
+    TRACE_NODE(ply, depth);
+
+    SearchFrame &frame = m_frames[ply];
+    frame.count = 0;
+    frame.pv_length = 0;
+
+    // a leaf, or any position once the search is stopped, is evaluated as is
+    if (depth == 0 || m_aborted) {
+        return evaluate(state);
+    }
+
+    // generate the actions of the side to move
+    STATS_ADD(movegen_calls, 1);
+    frame.count = state.get_actions<C>(frame.children);
+    STATS_BRANCHING(frame.count);
+    m_nodes += frame.count;
+    STATS_ADD(nodes, frame.count);
+
+    // stop at the node limit, and check the clock every so often
+    if (m_node_limit > 0 && m_nodes >= m_node_limit) {
+        m_aborted = true;
+    }
+    if (m_timed && (m_nodes & 0x3FF) < (long)frame.count) {
+        if (std::chrono::steady_clock::now() > m_deadline) {
+            m_aborted = true;
+        }
+        TRACE_EVENT(TIME_CHECK, ply, m_aborted);
+    }
+
+    // a side with no legal action has lost
+    if (frame.count == 0) {
+        return (C == BLACK) ? -LOSS_EVAL : LOSS_EVAL;
+    }
+
+    // black maximizes (evaluation starts low), white minimizes
+    float best = (C == BLACK) ? -1e6 : 1e6;
+    int best_index = -1;
+
+    // draws scored below this node may depend on positions above it
+    const int index = (int)m_keys.size() - 1;
+    const int outer_origin = m_draw_origin;
+    m_draw_origin = INT_MAX;
+
+    // search each action in turn; only multi-takes keep the same side
+    const SearchFrame &next = m_frames[ply + 1];
+    for (int i = 0; i < frame.count; ++i) {
+        const Board &child = frame.children[i];
+
+        // a repeated position is a draw, however the cycle would continue
+        m_keys.push(child);
+        float value;
+        if (m_keys.is_draw()) {
+            value = DRAW_EVAL;
+            m_frames[ply + 1].pv_length = 0;
+
+            // the draw rests on the positions since the last irreversible ply
+            m_draw_origin = std::min(m_draw_origin,
+                                     (int)m_keys.size() - 1 - m_keys.reversible());
+        } else if (depth - 1 >= CACHE_MIN_DEPTH &&
+                   probe_node(child, depth - 1, value)) {
+            m_frames[ply + 1].pv_length = 0;
+
+            // the cache is what cuts a subtree short, as every action is
+            // searched
+            STATS_CUTOFF(i);
+            TRACE_EVENT(CUTOFF, ply, i);
+        } else if (child.get_turn() == C) {
+            value = search_node<C>(child, depth - 1, ply + 1);
+        } else {
+            value = search_node<OTHER>(child, depth - 1, ply + 1);
+        }
+        m_keys.pop();
+        frame.values[i] = value;
+
+        // the first best action leads the PV, followed by its own
+        if ((C == BLACK) ? value > best : value < best) {
+            best = value;
+            best_index = i;
+            frame.pv[0] = child.get_last_action();
+            std::copy(next.pv, next.pv + next.pv_length, frame.pv + 1);
+            frame.pv_length = next.pv_length + 1;
+        }
+    }
+
+    // a value that rests on how this node was reached holds only here
+    const bool history_free = m_draw_origin >= index;
+    m_draw_origin = std::min(m_draw_origin, outer_origin);
+
+    // keep deep, complete results for later searches (and other processes)
+    if (depth >= CACHE_MIN_DEPTH && !m_aborted && best_index >= 0 &&
+        history_free) {
+        const Action &action = frame.pv[0];
+        store_cache(state, CacheEntry {
+            best, depth, EXACT, action.src, action.dst});
+    }
+
+    return best;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Uses a cached result for a position searched at least "depth" plies deep.
+bool MinMax::probe_node(const Board &state, int depth, float &eval) {
+    CacheEntry cached;
+    if (!probe_cache(state, cached) || cached.bound != EXACT ||
+        cached.depth < depth) {
+
+        return false;
+    }
+
+    eval = cached.score;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,105 @@
+/* -----------------------------------------------------------------------------
+search.cc
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "ai/search.hh"
+#include "ai/book.hh"
+#include "ai/cache.hh"
+#include "ai/mcts.hh"
+#include "ai/minmax.hh"
+#include "ai/trace.hh"
+#include "engine/board.hh"
+
+#include <memory>
+#include <random>
+
+////////////////////////////////////////////////////////////////////////////////
+
+const Book *Search::s_book = nullptr;
+AnalysisCache *Search::s_cache = nullptr;
+
+// Seed for newly created generators (random unless set with Search::seed).
+static unsigned s_seed = std::random_device{}();
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Search::use_book(const Book *book) {
+    s_book = book;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Search::use_cache(AnalysisCache *cache) {
+    s_cache = cache;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Search::set_game(const GameRecord &game) {
+    m_keys.assign(game);
+    m_keys.pop();
+    m_game_key = game.get_board().get_key();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Search::seed(unsigned seed) {
+    s_seed = seed;
+    generator().seed(seed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool Search::probe_book(const Board &state, Board &result) {
+    return s_book && s_book->probe(state, generator(), result);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool Search::probe_cache(const Board &state, CacheEntry &entry) {
+    if (!s_cache) {
+        return false;
+    }
+
+    STATS_ADD(tt_probes, 1);
+    if (!s_cache->probe(state.get_key(), entry)) {
+        return false;
+    }
+
+    STATS_ADD(tt_hits, 1);
+    TRACE_EVENT(CACHE_HIT, 0, entry.depth);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Search::store_cache(const Board &state, const CacheEntry &entry) {
+    if (s_cache) {
+        s_cache->store(state.get_key(), entry);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Each thread owns one generator, seeded once instead of per call.
+std::mt19937 &Search::generator() {
+    thread_local std::mt19937 gen(s_seed);
+    return gen;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<Search> make_search(Backend backend, Color playing_for, int depth) {
+    switch (backend) {
+    case MCTS_SEARCH:
+        return std::unique_ptr<Search>(new Mcts(playing_for, depth));
+    case MINMAX_SEARCH:
+    default:
+        return std::unique_ptr<Search>(new MinMax(playing_for, depth));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,82 @@
+/* -----------------------------------------------------------------------------
+stats.cc
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "ai/stats.hh"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////
+
+void SearchStats::clear() {
+    std::memset(this, 0, sizeof(*this));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SearchStats &SearchStats::operator+=(const SearchStats &other) {
+    nodes += other.nodes;
+    leaf_evals += other.leaf_evals;
+    movegen_calls += other.movegen_calls;
+    tt_probes += other.tt_probes;
+    tt_hits += other.tt_hits;
+    quiescence_nodes += other.quiescence_nodes;
+
+    for (int i = 0; i < STATS_MOVES; ++i) {
+        cutoffs[i] += other.cutoffs[i];
+        branching[i] += other.branching[i];
+    }
+
+    for (int i = 0; i < STATS_DEPTHS; ++i) {
+        depth_seconds[i] += other.depth_seconds[i];
+    }
+
+    return *this;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::string format_stats(const SearchStats &stats) {
+    char text[256];
+    std::snprintf(text, sizeof(text),
+                  "nodes=%llu evals=%llu movegen=%llu tt=%llu/%llu qnodes=%llu",
+                  (unsigned long long)stats.nodes,
+                  (unsigned long long)stats.leaf_evals,
+                  (unsigned long long)stats.movegen_calls,
+                  (unsigned long long)stats.tt_hits,
+                  (unsigned long long)stats.tt_probes,
+                  (unsigned long long)stats.quiescence_nodes);
+    std::string summary = text;
+
+    // cutoffs and branching factors, listing only non-empty buckets
+    const uint64_t *histograms[2] {stats.cutoffs, stats.branching};
+    const char *names[2] {" cutoffs=", " branching="};
+    for (int h = 0; h < 2; ++h) {
+        std::string buckets;
+        for (int i = 0; i < STATS_MOVES; ++i) {
+            if (histograms[h][i] == 0) continue;
+            buckets += (buckets.empty() ? "" : ",") + std::to_string(i) + ":" +
+                       std::to_string(histograms[h][i]);
+        }
+        summary += names[h] + (buckets.empty() ? "-" : buckets);
+    }
+
+    // milliseconds per completed depth
+    std::string depths;
+    for (int i = 0; i < STATS_DEPTHS; ++i) {
+        if (stats.depth_seconds[i] == 0) continue;
+        std::snprintf(text, sizeof(text), "%s%d:%.1f", depths.empty() ? "" : ",",
+                      i, stats.depth_seconds[i] * 1000);
+        depths += text;
+    }
+    summary += " depth_ms=" + (depths.empty() ? std::string("-") : depths);
+
+    return summary;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,246 @@
+/* -----------------------------------------------------------------------------
+trace.cc
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "ai/trace.hh"
+#include "engine/board.hh"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Events each thread can buffer between flushes (a power of two).
+const uint64_t RING_CAPACITY {1 << 14};
+
+// How often the background thread drains the rings.
+const auto FLUSH_INTERVAL {std::chrono::milliseconds(10)};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// One thread's events. Only the owning thread pushes and only the flusher
+// pops, so the two indices are all the synchronization needed.
+struct TraceRing {
+    TraceEvent events[RING_CAPACITY];
+
+    // total events pushed (by the owner) and popped (by the flusher)
+    alignas(64) std::atomic<uint64_t> head {0};
+    alignas(64) std::atomic<uint64_t> tail {0};
+
+    // events lost to a full ring since the last flush
+    std::atomic<uint32_t> dropped {0};
+};
+
+// Everything shared by the recording threads and the flusher.
+struct Recorder {
+    std::mutex mutex;
+
+    // every ring, kept for the life of the process so a thread may exit with
+    // events still to be written; an exited thread's ring, and its id, go to
+    // the next thread that needs one
+    std::vector<std::unique_ptr<TraceRing>> rings;
+    std::vector<uint16_t> free_rings;
+
+    FILE *file = nullptr;
+    std::chrono::steady_clock::time_point start;
+
+    std::thread flusher;
+    bool stopping = false;
+    std::condition_variable wake;
+
+    // ends any trace in progress, writing out what is buffered
+    void stop();
+
+    // a trace still running at exit is finished, not abandoned
+    ~Recorder() { stop(); }
+};
+
+Recorder &recorder() {
+    static Recorder recorder;
+    return recorder;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Holds a thread's ring while the thread runs, and frees it when it exits.
+struct RingOwner {
+    TraceRing *ring = nullptr;
+    uint16_t id = 0;
+
+    ~RingOwner() {
+        if (ring) {
+            Recorder &rec = recorder();
+            std::lock_guard<std::mutex> lock(rec.mutex);
+            rec.free_rings.push_back(id);
+        }
+    }
+};
+
+// Finds the calling thread's ring on its first event, reusing a free one if
+// there is one (returns null once every id is taken).
+TraceRing *thread_ring(uint16_t &thread) {
+    thread_local RingOwner owner;
+
+    if (!owner.ring) {
+        Recorder &rec = recorder();
+        std::lock_guard<std::mutex> lock(rec.mutex);
+        if (!rec.free_rings.empty()) {
+            owner.id = rec.free_rings.back();
+            rec.free_rings.pop_back();
+        } else if (rec.rings.size() <= UINT16_MAX) {
+            owner.id = (uint16_t)rec.rings.size();
+            rec.rings.emplace_back(new TraceRing);
+        } else {
+            return nullptr;
+        }
+        owner.ring = rec.rings[owner.id].get();
+    }
+
+    thread = owner.id;
+    return owner.ring;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Writes out whatever each ring holds (called with the recorder locked).
+void drain_rings(Recorder &rec) {
+    for (size_t i = 0; i < rec.rings.size(); ++i) {
+        TraceRing &ring = *rec.rings[i];
+        const uint64_t head = ring.head.load(std::memory_order_acquire);
+        const uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+
+        // the buffered events, in at most two pieces around the wrap
+        const uint64_t first = tail & (RING_CAPACITY - 1);
+        const uint64_t count = head - tail;
+        const uint64_t before_wrap =
+            (count < RING_CAPACITY - first) ? count : RING_CAPACITY - first;
+        std::fwrite(ring.events + first, sizeof(TraceEvent), before_wrap,
+                    rec.file);
+        std::fwrite(ring.events, sizeof(TraceEvent), count - before_wrap,
+                    rec.file);
+        ring.tail.store(head, std::memory_order_release);
+
+        // the flusher notes drops on the ring owner's behalf
+        const uint32_t dropped = ring.dropped.exchange(0);
+        if (dropped > 0) {
+            const TraceEvent event {
+                (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - rec.start).count(),
+                (uint16_t)i, EVENTS_DROPPED, 0, dropped};
+            std::fwrite(&event, sizeof(event), 1, rec.file);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int start_trace(const std::string &path, uint32_t sample_rate) {
+    stop_trace();
+
+    Recorder &rec = recorder();
+    std::unique_lock<std::mutex> lock(rec.mutex);
+
+    rec.file = std::fopen(path.c_str(), "wb");
+    if (!rec.file) {
+        return ACTION_FAILURE;
+    }
+
+    TraceHeader header {};
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header.version = TRACE_VERSION;
+    header.sample_rate = (sample_rate > 0) ? sample_rate : 1;
+    std::fwrite(&header, sizeof(header), 1, rec.file);
+
+    // forget events left over from an earlier trace
+    for (auto &ring : rec.rings) {
+        ring->tail.store(ring->head.load());
+        ring->dropped.store(0);
+    }
+
+    rec.start = std::chrono::steady_clock::now();
+    rec.stopping = false;
+    trace_rate().store(header.sample_rate);
+
+    rec.flusher = std::thread([&rec] {
+        std::unique_lock<std::mutex> lock(rec.mutex);
+        while (!rec.stopping) {
+            rec.wake.wait_for(lock, FLUSH_INTERVAL);
+            drain_rings(rec);
+        }
+    });
+
+    trace_enabled().store(true);
+    return ACTION_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Recorder::stop() {
+    trace_enabled().store(false);
+
+    // the flusher makes one last pass before it exits
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    if (flusher.joinable()) {
+        flusher.join();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file) {
+        drain_rings(*this);
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void stop_trace() {
+    recorder().stop();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void trace_event(TraceType type, int ply, uint32_t value) {
+
+    // acquire, so the start time set before tracing was enabled is seen
+    if (!trace_enabled().load(std::memory_order_acquire)) {
+        return;
+    }
+
+    uint16_t thread;
+    TraceRing *ring = thread_ring(thread);
+    if (!ring) {
+        return;
+    }
+
+    // a full ring drops the event rather than wait for the flusher
+    const uint64_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) == RING_CAPACITY) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - recorder().start;
+    ring->events[head & (RING_CAPACITY - 1)] = TraceEvent {
+        (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            elapsed).count(),
+        thread, type, (uint8_t)ply, value};
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////
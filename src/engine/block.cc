@@ -0,0 +1,179 @@
+/* -----------------------------------------------------------------------------
+block.cc
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "engine/block.hh"
+#include "engine/board.hh"
+
+#include <cstring>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Vector kernels are only built for x86, where the CPU is asked at run time.
+#if defined(__x86_64__) || defined(__i386__)
+#define BLOCK_VECTOR_KERNELS 1
+#else
+#define BLOCK_VECTOR_KERNELS 0
+#endif
+
+// Four and eight positions per register. These are GCC vector types, so the
+// same kernel source becomes AVX2 or AVX-512 code depending on the target of
+// the function it is inlined into.
+typedef uint64_t Lanes4 __attribute__((vector_size(32)));
+typedef uint64_t Lanes8 __attribute__((vector_size(64)));
+
+using G = EnglishGeometry;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Computes the movers and takers of one lane group, with the same shifts as
+// Board::get_movers/get_takers (a step in direction D lands D squares on).
+template <Color C, typename V>
+__attribute__((always_inline)) inline
+void lane_actors(const V &black, const V &white, const V &kings,
+                 V moves[4], V takes[4]) {
+
+    // men only act forward, kings both ways
+    const V own = (C == BLACK) ? black : white;
+    const V prey = (C == BLACK) ? white : black;
+    const V open = ~(black | white) & G::ON_BOARD.word();
+    const V north = ColorTraits<C>::MEN_NORTH ? own : own & kings;
+    const V south = ColorTraits<C>::MEN_NORTH ? own & kings : own;
+
+    // find pieces cornerwise to an opponent with an open square behind it
+    takes[0] = (((open >> G::NW) & prey) >> G::NW) & north;
+    takes[1] = (((open >> G::NE) & prey) >> G::NE) & north;
+    takes[2] = (((open << -G::SW) & prey) << -G::SW) & south;
+    takes[3] = (((open << -G::SE) & prey) << -G::SE) & south;
+
+    // no piece can move if a take is available: all ones where none is
+    const V any = takes[0] | takes[1] | takes[2] | takes[3];
+    const V no_take = ((any | -any) >> 63) - 1;
+
+    moves[0] = (open >> G::NW) & north & no_take;
+    moves[1] = (open >> G::NE) & north & no_take;
+    moves[2] = (open << -G::SW) & south & no_take;
+    moves[3] = (open << -G::SE) & south & no_take;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Runs the kernel over the first "count" positions, one lane group at a time.
+template <Color C, typename V>
+__attribute__((always_inline)) inline
+void block_actors(const uint64_t *black, const uint64_t *white,
+                  const uint64_t *kings, int count, BlockActors &actors) {
+    constexpr int LANES = sizeof(V) / sizeof(uint64_t);
+
+    for (int i = 0; i < count; i += LANES) {
+        V b, w, k;
+        std::memcpy(&b, black + i, sizeof(V));
+        std::memcpy(&w, white + i, sizeof(V));
+        std::memcpy(&k, kings + i, sizeof(V));
+
+        V moves[4], takes[4];
+        lane_actors<C>(b, w, k, moves, takes);
+
+        for (int d = 0; d < 4; ++d) {
+            std::memcpy(&actors.moves[d][i], &moves[d], sizeof(V));
+            std::memcpy(&actors.takes[d][i], &takes[d], sizeof(V));
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <Color C>
+void scalar_actors(const uint64_t *black, const uint64_t *white,
+                   const uint64_t *kings, int count, BlockActors &actors) {
+    block_actors<C, uint64_t>(black, white, kings, count, actors);
+}
+
+#if BLOCK_VECTOR_KERNELS
+template <Color C>
+__attribute__((target("avx2")))
+void avx2_actors(const uint64_t *black, const uint64_t *white,
+                 const uint64_t *kings, int count, BlockActors &actors) {
+    block_actors<C, Lanes4>(black, white, kings, count, actors);
+}
+
+template <Color C>
+__attribute__((target("avx512f")))
+void avx512_actors(const uint64_t *black, const uint64_t *white,
+                   const uint64_t *kings, int count, BlockActors &actors) {
+    block_actors<C, Lanes8>(black, white, kings, count, actors);
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+BlockKernel best_kernel() {
+#if BLOCK_VECTOR_KERNELS
+    static const BlockKernel best =
+        __builtin_cpu_supports("avx512f") ? AVX512_KERNEL :
+        __builtin_cpu_supports("avx2") ? AVX2_KERNEL : SCALAR_KERNEL;
+    return best;
+#else
+    return SCALAR_KERNEL;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool BoardBlock::add(const Board &board) {
+    if (m_count == BLOCK_SIZE) {
+        return false;
+    }
+
+    m_black[m_count] = board.get_black().word();
+    m_white[m_count] = board.get_white().word();
+    m_kings[m_count] = board.get_kings().word();
+    ++m_count;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void BoardBlock::clear() {
+    std::memset(m_black, 0, sizeof(m_black));
+    std::memset(m_white, 0, sizeof(m_white));
+    std::memset(m_kings, 0, sizeof(m_kings));
+    m_count = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int BoardBlock::size() const {
+    return m_count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void BoardBlock::find_actors(Color turn, BlockActors &actors,
+                             BlockKernel kernel) const {
+
+    // a kernel the CPU lacks falls back to the next narrower one
+    kernel = (kernel < best_kernel()) ? kernel : best_kernel();
+
+    // vector kernels run whole registers: the unused positions are empty
+    // and yield empty masks
+    const int count = (kernel == SCALAR_KERNEL) ? m_count : (m_count + 7) & ~7;
+
+    using Kernel = void (*)(const uint64_t *, const uint64_t *,
+                            const uint64_t *, int, BlockActors &);
+    Kernel run = (turn == BLACK) ? scalar_actors<BLACK> : scalar_actors<WHITE>;
+#if BLOCK_VECTOR_KERNELS
+    if (kernel == AVX2_KERNEL) {
+        run = (turn == BLACK) ? avx2_actors<BLACK> : avx2_actors<WHITE>;
+    } else if (kernel == AVX512_KERNEL) {
+        run = (turn == BLACK) ? avx512_actors<BLACK> : avx512_actors<WHITE>;
+    }
+#endif
+
+    run(m_black, m_white, m_kings, count, actors);
+}
+
+////////////////////////////////////////////////////////////////////////////////
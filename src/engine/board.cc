@@ -1,644 +1,687 @@
-/* -----------------------------------------------------------------------------
-board.cc
-
-Name: Joseph Sturm
-Date: 01/27/2020
------------------------------------------------------------------------------ */
-
-#include "engine/board.hh"
-#include "ai/minmax.hh"
-
-#include <bitset>
-#include <vector>
-
-////////////////////////////////////////////////////////////////////////////////
-
-enum Direction {NW = 4, NE = 5, SW = -5, SE = -4};
-
-////////////////////////////////////////////////////////////////////////////////
-
-Position bit_mask(int sq) {
-    Position mask = EMPTY_BOARD;
-    mask.set(sq);
-    return mask;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-const Position &Board::get_black() const {
-    return m_black;
-}
-
-const Position &Board::get_white() const {
-    return m_white;
-}
-
-const Position &Board::get_kings() const {
-    return m_kings;
-}
-
-const History &Board::get_history() const {
-    return m_history;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-Position Board::get_open_squares() const {
-    return ~m_black & ~m_white & ON_BOARD;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-Actors Board::get_black_takers() const {
-    Actors takers {};
-
-    // fetch the previous action
-    const Action prev = m_history.back();
-
-    // black can't take after moving or promoting
-    if (prev.color == BLACK && (prev.type == MOVE || prev.promoted)) {
-        return takers;
-    }
-
-    // black can't take if white is making a second take
-    if (prev.color == WHITE && prev.type == TAKE && 
-        get_white_takers().any_action) {
-
-        return takers;
-    }
-
-    // find pieces cornerwise to open squares
-    const Position OPEN = get_open_squares();
-    const Position NW_OPEN = (OPEN >> 4);
-    const Position NE_OPEN = (OPEN >> 5);
-    const Position SW_OPEN = (OPEN << 5);
-    const Position SE_OPEN = (OPEN << 4);
-
-    // find all black takers
-    takers.nw = ((NW_OPEN & m_white) >> 4) & m_black;
-    takers.ne = ((NE_OPEN & m_white) >> 5) & m_black;
-    takers.sw = ((SW_OPEN & m_white) << 5) & m_black & m_kings;
-    takers.se = ((SE_OPEN & m_white) << 4) & m_black & m_kings;
-
-    // if previous action was a black take, restrict takers
-    if (prev.color == BLACK && prev.type == TAKE) {
-        const Position MASK = bit_mask(prev.dst);
-        takers.nw &= MASK;
-        takers.ne &= MASK;
-        takers.sw &= MASK;
-        takers.se &= MASK;
-    }
-
-    // set flag to determine if takes are possible
-    if (takers.nw.any() || takers.ne.any() ||
-        takers.sw.any() || takers.se.any()) {
-
-        takers.any_action = true;
-    }
-
-    return takers;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-Actors Board::get_white_takers() const {
-    Actors takers {};
-    
-    // fetch the previous action
-    const Action prev = m_history.back();
-    
-    // white can't take after moving or promoting
-    if (prev.color == WHITE && (prev.type == MOVE || prev.promoted)) {
-        return takers;
-    }
-    
-    // white can't take if black is making a second take
-    if (prev.color == BLACK && prev.type == TAKE && 
-        get_black_takers().any_action) {
-            
-        return takers;
-    }
-    
-    // find pieces cornerwise to open squares
-    const Position OPEN = get_open_squares();
-    const Position NW_OPEN = (OPEN >> 4);
-    const Position NE_OPEN = (OPEN >> 5);
-    const Position SW_OPEN = (OPEN << 5);
-    const Position SE_OPEN = (OPEN << 4);
-    
-    // calculate all white takers
-    takers.nw = ((NW_OPEN & m_black) >> 4) & m_white & m_kings;
-    takers.ne = ((NE_OPEN & m_black) >> 5) & m_white & m_kings;
-    takers.sw = ((SW_OPEN & m_black) << 5) & m_white;
-    takers.se = ((SE_OPEN & m_black) << 4) & m_white;
-    
-    // if previous action was a white take, restrict takers
-    if (prev.color == WHITE && prev.type == TAKE) {
-        const Position MASK = bit_mask(prev.dst);
-        takers.nw &= MASK;
-        takers.ne &= MASK;
-        takers.sw &= MASK;
-        takers.se &= MASK;
-    }
-    
-    // set flag to determine if takes are possible
-    if (takers.nw.any() || takers.ne.any() ||
-        takers.sw.any() || takers.se.any()) {
-
-        takers.any_action = true;
-    }
-
-    return takers;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-Actors Board::get_black_movers() const {
-    Actors movers {};
-    
-    // fetch the previous action
-    const Action prev = m_history.back();
-    
-    // black can't move after taking any action
-    if (prev.color == BLACK) {
-        return movers;
-    }
-    
-    // no piece can move if a take is available
-    if (get_black_takers().any_action) {
-        return movers;
-    }
-    
-    // calculate all black movers
-    const Position OPEN = get_open_squares();
-    movers.nw = (OPEN >> 4) & m_black;
-    movers.ne = (OPEN >> 5) & m_black;
-    movers.sw = (OPEN << 5) & m_black & m_kings;
-    movers.se = (OPEN << 4) & m_black & m_kings;
-    
-    // determine whether any moves are possible
-    if (movers.nw.any() || movers.ne.any() ||
-        movers.sw.any() || movers.se.any()) {
-            
-        movers.any_action = true;
-    }
-    
-    return movers;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-Actors Board::get_white_movers() const {
-    Actors movers {};
-    
-    // fetch the previous action
-    const Action prev = m_history.back();
-    
-    // white can't move after taking any action
-    if (prev.color == WHITE) {
-        return movers;
-    }
-    
-    // no piece can move if a take is available
-    if (get_white_takers().any_action) {
-        return movers;
-    }
-    
-    // calculate all white movers
-    const Position OPEN = get_open_squares();
-    movers.nw = (OPEN >> 4) & m_white & m_kings;
-    movers.ne = (OPEN >> 5) & m_white & m_kings;
-    movers.sw = (OPEN << 5) & m_white;
-    movers.se = (OPEN << 4) & m_white;
-    
-    // determine whether any moves are possible
-    if (movers.nw.any() || movers.ne.any() ||
-        movers.sw.any() || movers.se.any()) {
-            
-        movers.any_action = true;
-    }
-    
-    return movers;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-Square Board::get_square_info(int sq) const {
-    Square info {};
-    
-    // determine color and promotion status
-    info.is_black = m_black.test(sq);
-    info.is_white = m_white.test(sq);
-    info.is_kings = m_kings.test(sq);
-    
-    // calculate movers and takers based on color
-    Actors movers;
-    Actors takers;
-    if (info.is_black) {
-        movers = get_black_movers();
-        takers = get_black_takers();
-    } else if (info.is_white) {
-        movers = get_white_movers();
-        takers = get_white_takers();
-    } else {
-        return info;
-    }
-    
-    // fill out PieceInfo struct
-    info.move_nw = movers.nw.test(sq);
-    info.move_ne = movers.ne.test(sq);
-    info.move_sw = movers.sw.test(sq);
-    info.move_se = movers.se.test(sq);
-    info.take_nw = takers.nw.test(sq);
-    info.take_ne = takers.ne.test(sq);
-    info.take_sw = takers.sw.test(sq);
-    info.take_se = takers.se.test(sq);
-    
-    return info;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-int Board::player_move(int sq, int dir, Square *info) {
-    
-    // if Square info not provided, calculate Square info
-    if (info == nullptr) {
-        Square calculated_info = get_square_info(sq);
-        info = &calculated_info;
-    }
-    
-    // determine whether specified move is possible
-    bool move_possible;
-    switch (dir) {
-    case NW:
-        move_possible = info->move_nw;
-        break;
-    case NE:
-        move_possible = info->move_ne;
-        break;
-    case SW:
-        move_possible = info->move_sw;
-        break;
-    case SE:
-        move_possible = info->move_se;
-        break;
-    default:
-        move_possible = false;
-        break;
-    }
-    
-    // if move is possble, move appropriate pieces
-    if (move_possible) {
-        if (info->is_black) move_black(sq, dir);
-        if (info->is_white) move_white(sq, dir);
-        if (info->is_kings) move_kings(sq, dir);
-        return ACTION_SUCCESS;
-    }
-    
-    return ACTION_FAILURE;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-int Board::player_take(int sq, int dir, Square *info) {
-    
-    // if Square info not provided, calculate Square info
-    if (info == nullptr) {
-        Square calculated_info = get_square_info(sq);
-        info = &calculated_info;
-    }
-    
-    // determine whether specified take is possible
-    bool take_possible;
-    switch (dir) {
-    case NW:
-        take_possible = info->take_nw;
-        break;
-    case NE:
-        take_possible = info->take_ne;
-        break;
-    case SW:
-        take_possible = info->take_sw;
-        break;
-    case SE:
-        take_possible = info->take_se;
-        break;
-    default:
-        take_possible = false;
-        break;
-    }
-    
-    // if take is possble, take appropriate pieces
-    if (take_possible) {
-        if (info->is_black) take_black(sq, dir);
-        if (info->is_white) take_white(sq, dir);
-        if (info->is_kings) take_kings(sq, dir);
-        return ACTION_SUCCESS;
-    }
-    
-    return ACTION_FAILURE;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-std::vector<Board> Board::get_black_actions() const {
-    std::vector<Board> actions {};
-    
-    // fetch the previous action
-    const Action prev = m_history.back();
-    
-    // short circuit if black just moved or promoted
-    if (prev.color == BLACK && (prev.type == MOVE || prev.promoted)) {
-        return actions;
-    }
-    
-    // calculate movers and takers
-    const Actors MOVERS = get_black_movers();
-    const Actors TAKERS = get_black_takers();
-    
-    // calculate all actors
-    const Position ALL_ACTORS =
-        MOVERS.nw | MOVERS.ne | MOVERS.sw | MOVERS.se |
-        TAKERS.nw | TAKERS.ne | TAKERS.sw | TAKERS.se;
-
-    // check each square and add all actions to vector
-    for (int sq = 0; sq < BOARD_SIZE; ++sq) {
-        
-        // if a square has no actor, skip it
-        if (!ALL_ACTORS.test(sq)) {
-            continue;
-        }
-        
-        // get info for current square
-        Square info = get_square_info(sq);
-        
-        // add legal actions to vector
-        if (info.move_nw) {
-            actions.push_back(*this);
-            actions.back().player_move(sq, NW, &info);
-        }
-        
-        if (info.move_ne) {
-            actions.push_back(*this);
-            actions.back().player_move(sq, NE, &info);
-        }
-        
-        if (info.move_sw) {
-            actions.push_back(*this);
-            actions.back().player_move(sq, SW, &info);
-        }
-        
-        if (info.move_se) {
-            actions.push_back(*this);
-            actions.back().player_move(sq, SE, &info);
-        }
-        
-        if (info.take_nw) {
-            actions.push_back(*this);
-            actions.back().player_take(sq, NW, &info);
-        }
-        
-        if (info.take_ne) {
-            actions.push_back(*this);
-            actions.back().player_take(sq, NE, &info);
-        }
-        
-        if (info.take_sw) {
-            actions.push_back(*this);
-            actions.back().player_take(sq, SW, &info);
-        }
-        
-        if (info.take_se) {
-            actions.push_back(*this);
-            actions.back().player_take(sq, SE, &info);
-        }
-    }
-    
-    return actions;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-std::vector<Board> Board::get_white_actions() const {
-    std::vector<Board> actions {};
-    
-    // fetch the previous action
-    const Action prev = m_history.back();
-    
-    // short circuit if white just moved or promoted
-    if (prev.color == WHITE && (prev.type == MOVE || prev.promoted)) {
-        return actions;
-    }
-    
-    // calculate movers and takers
-    const Actors MOVERS = get_white_movers();
-    const Actors TAKERS = get_white_takers();
-    
-    // calculate all actors
-    const Position ALL_ACTORS =
-        MOVERS.nw | MOVERS.ne | MOVERS.sw | MOVERS.se |
-        TAKERS.nw | TAKERS.ne | TAKERS.sw | TAKERS.se;
-    
-    // check each square and add all actions to vector
-    for (int sq = 0; sq < BOARD_SIZE; ++sq) {
-        
-        // if a square has no actor, skip it
-        if (!ALL_ACTORS.test(sq)) {
-            continue;
-        }
-        
-        // get info for current square
-        Square info = get_square_info(sq);
-        
-        // add legal actions to vector
-        if (info.move_nw) {
-            actions.push_back(*this);
-            actions.back().player_move(sq, NW, &info);
-        }
-        
-        if (info.move_ne) {
-            actions.push_back(*this);
-            actions.back().player_move(sq, NE, &info);
-        }
-        
-        if (info.move_sw) {
-            actions.push_back(*this);
-            actions.back().player_move(sq, SW, &info);
-        }
-        
-        if (info.move_se) {
-            actions.push_back(*this);
-            actions.back().player_move(sq, SE, &info);
-        }
-        
-        if (info.take_nw) {
-            actions.push_back(*this);
-            actions.back().player_take(sq, NW, &info);
-        }
-        
-        if (info.take_ne) {
-            actions.push_back(*this);
-            actions.back().player_take(sq, NE, &info);
-        }
-        
-        if (info.take_sw) {
-            actions.push_back(*this);
-            actions.back().player_take(sq, SW, &info);
-        }
-        
-        if (info.take_se) {
-            actions.push_back(*this);
-            actions.back().player_take(sq, SE, &info);
-        }
-    }
-    
-    return actions;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-Board Board::ai_black_action(int depth) const {
-    MinMax computer(BLACK, depth);
-    return computer.best_move(*this);
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-Board Board::ai_white_action(int depth) const {
-    MinMax computer(WHITE, depth);
-    return computer.best_move(*this);
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-void Board::move_black(int sq, int dir) {
-    Action move;
-    
-    // set color and action type
-    move.color = BLACK;
-    move.type = MOVE;
-    
-    // set source and destination squares
-    move.src = sq;
-    move.dst = sq + dir;
-    
-    // set whether this action results in a promotion
-    move.promoted = !m_kings.test(move.src) && TOP_ROW.test(move.dst);
-    
-    // perform the move
-    m_black.reset(move.src);
-    m_black.set(move.dst);
-    
-    // update kings if piece lands in top row
-    m_kings = m_kings | (m_black & TOP_ROW);
-    
-    // add move to board history
-    this->m_history.push_back(move);
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-void Board::move_white(int sq, int dir) {
-    Action move;
-    
-    // set color and action type
-    move.color = WHITE;
-    move.type = MOVE;
-    
-    // set source and destination squares
-    move.src = sq;
-    move.dst = sq + dir;
-    
-    // set whether this action results in a promotion
-    move.promoted = !m_kings.test(move.src) && BOT_ROW.test(move.dst);
-    
-    // perform the move
-    m_white.reset(move.src);
-    m_black.set(move.dst);
-    
-    // update kings if piece lands in bot row
-    m_kings = m_kings | (m_white & BOT_ROW);
-    
-    // add move to board history
-    this->m_history.push_back(move);
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-void Board::move_kings(int sq, int dir) {
-    
-    // perform the move
-    m_kings.reset(sq);
-    m_kings.set(sq + dir);
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-void Board::take_black(int sq, int dir) {
-    Action take;
-    
-    // set color and action type
-    take.color = BLACK;
-    take.type = TAKE;
-    
-    // set source, destination, captured squares
-    take.src = sq;
-    take.dst = sq + (2 * dir);
-    const int CAPTURED = sq + dir;
-    
-    // set whether this action results in a promotion
-    take.promoted = !m_kings.test(take.src) && TOP_ROW.test(take.dst);
-    
-    // perform the take
-    m_black.reset(take.src);
-    m_white.reset(CAPTURED);
-    m_black.set(take.dst);
-    
-    // update kings if piece lands in top row
-    m_kings = m_kings | (m_black & TOP_ROW);
-    
-    // add take to board history
-    this->m_history.push_back(take);
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-void Board::take_white(int sq, int dir) {
-    Action take;
-    
-    // set color and action type
-    take.color = WHITE;
-    take.type = TAKE;
-    
-    // set source, destination, captured squares
-    take.src = sq;
-    take.dst = sq + (2 * dir);
-    const int CAPTURED = sq + dir;
-    
-    // set whether this action results in a promotion
-    take.promoted = !m_kings.test(take.src) && BOT_ROW.test(take.dst);
-    
-    // perform the take
-    m_white.reset(take.src);
-    m_black.reset(CAPTURED);
-    m_white.set(take.dst);
-    
-    // update kings if piece lands in top row
-    m_kings = m_kings | (m_black & BOT_ROW);
-    
-    // add take to board history
-    this->m_history.push_back(take);
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-void Board::take_kings(int sq, int dir) {
-    
-    // perform the take
-    m_kings.reset(sq);
-    m_kings.set(sq + (2 * dir));
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-int main() {}
\ No newline at end of file
+/* -----------------------------------------------------------------------------
+board.cc
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "engine/board.hh"
+#include "ai/search.hh"
+
+#include <new>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Random keys used to hash positions (see Board::get_key).
+template <typename G>
+struct ZobristKeys {
+    uint64_t black[G::SIZE];
+    uint64_t white[G::SIZE];
+    uint64_t kings[G::SIZE];
+    uint64_t pending[G::SIZE];
+    uint64_t white_turn;
+};
+
+// Steps a splitmix64 generator, used to fill the key table at compile time.
+constexpr uint64_t splitmix64(uint64_t &state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+template <typename G>
+constexpr ZobristKeys<G> make_zobrist_keys() {
+    ZobristKeys<G> keys {};
+    uint64_t state = 0x436865636B657273ULL;
+    for (int sq = 0; sq < G::SIZE; ++sq) {
+        keys.black[sq] = splitmix64(state);
+        keys.white[sq] = splitmix64(state);
+        keys.kings[sq] = splitmix64(state);
+        keys.pending[sq] = splitmix64(state);
+    }
+    keys.white_turn = splitmix64(state);
+    return keys;
+}
+
+template <typename G>
+constexpr ZobristKeys<G> ZOBRIST = make_zobrist_keys<G>();
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Hashes every set square of a position with the given keys.
+template <typename Position>
+uint64_t hash_position(const Position &pos, const uint64_t *keys) {
+    uint64_t hash = 0;
+    auto bits = pos.word();
+    while (bits) {
+        hash ^= keys[lowest_bit(bits)];
+        bits &= bits - 1;
+    }
+    return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename Position>
+Position bit_mask(int sq) {
+    Position mask {};
+    mask.set(sq);
+    return mask;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Finds the squares from which a step in direction D lands in "to".
+template <int D, typename Position>
+Position step_from(const Position &to) {
+    if constexpr (D > 0) {
+        return to >> D;
+    } else {
+        return to << -D;
+    }
+}
+
+// The row where men of color C promote.
+template <typename G, Color C>
+constexpr typename G::Position PROMOTION_ROW =
+    ColorTraits<C>::MEN_NORTH ? G::TOP_ROW : G::BOT_ROW;
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+BasicBoard<G>::BasicBoard(const Position &black, const Position &white,
+                          const Position &kings, Color turn) {
+    m_black = black & G::ON_BOARD;
+    m_white = white & G::ON_BOARD & ~m_black;
+    m_kings = kings & (m_black | m_white);
+    m_turn = turn;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+const typename G::Position &BasicBoard<G>::get_black() const {
+    return m_black;
+}
+
+template <typename G>
+const typename G::Position &BasicBoard<G>::get_white() const {
+    return m_white;
+}
+
+template <typename G>
+const typename G::Position &BasicBoard<G>::get_kings() const {
+    return m_kings;
+}
+
+template <typename G>
+Color BasicBoard<G>::get_turn() const {
+    return (Color)m_turn;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+Action BasicBoard<G>::get_last_action() const {
+    return Action {(Color)m_last_color, (Type)m_last_type,
+                   m_last_src, m_last_dst, m_last_promoted};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+uint64_t BasicBoard<G>::get_key() const {
+
+    // hash piece locations
+    uint64_t key = hash_position(m_black, ZOBRIST<G>.black) ^
+                   hash_position(m_white, ZOBRIST<G>.white) ^
+                   hash_position(m_kings, ZOBRIST<G>.kings);
+
+    // hash the side to move
+    if (m_turn == WHITE) {
+        key ^= ZOBRIST<G>.white_turn;
+    }
+
+    // hash the piece that must continue a multi-take, if any
+    if (m_pending >= 0) {
+        key ^= ZOBRIST<G>.pending[m_pending];
+    }
+
+    return key;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+typename G::Position BasicBoard<G>::get_open_squares() const {
+    return ~m_black & ~m_white & G::ON_BOARD;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+template <Color C>
+const typename G::Position &BasicBoard<G>::get_side() const {
+    if constexpr (C == BLACK) {
+        return m_black;
+    } else {
+        return m_white;
+    }
+}
+
+template <typename G>
+template <Color C>
+typename G::Position &BasicBoard<G>::get_side() {
+    if constexpr (C == BLACK) {
+        return m_black;
+    } else {
+        return m_white;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+template <Color C>
+Actors<G> BasicBoard<G>::get_takers() const {
+    constexpr Color OTHER = ColorTraits<C>::OTHER;
+    Actors<G> takers {};
+
+    // only the side to move can take
+    if (m_turn != C) {
+        return takers;
+    }
+
+    // men only take forward, kings take both ways
+    const Position OPEN = get_open_squares();
+    const Position &OWN = get_side<C>();
+    const Position &PREY = get_side<OTHER>();
+    const Position NORTH = ColorTraits<C>::MEN_NORTH ? OWN : OWN & m_kings;
+    const Position SOUTH = ColorTraits<C>::MEN_NORTH ? OWN & m_kings : OWN;
+
+    // find pieces cornerwise to an opponent with an open square behind it
+    takers.nw = step_from<G::NW>(step_from<G::NW>(OPEN) & PREY) & NORTH;
+    takers.ne = step_from<G::NE>(step_from<G::NE>(OPEN) & PREY) & NORTH;
+    takers.sw = step_from<G::SW>(step_from<G::SW>(OPEN) & PREY) & SOUTH;
+    takers.se = step_from<G::SE>(step_from<G::SE>(OPEN) & PREY) & SOUTH;
+
+    // a piece part-way through a multi-take must continue alone
+    if (m_pending >= 0) {
+        const Position MASK = bit_mask<Position>(m_pending);
+        takers.nw &= MASK;
+        takers.ne &= MASK;
+        takers.sw &= MASK;
+        takers.se &= MASK;
+    }
+
+    // set flag to determine if takes are possible
+    takers.any_action = (takers.nw | takers.ne | takers.sw | takers.se).any();
+
+    return takers;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+template <Color C>
+Actors<G> BasicBoard<G>::get_movers() const {
+    Actors<G> movers {};
+
+    // only the side to move can move, and not part-way through a take
+    if (m_turn != C || m_pending >= 0) {
+        return movers;
+    }
+
+    // no piece can move if a take is available
+    if (get_takers<C>().any_action) {
+        return movers;
+    }
+
+    // men only move forward, kings move both ways
+    const Position OPEN = get_open_squares();
+    const Position &OWN = get_side<C>();
+    const Position NORTH = ColorTraits<C>::MEN_NORTH ? OWN : OWN & m_kings;
+    const Position SOUTH = ColorTraits<C>::MEN_NORTH ? OWN & m_kings : OWN;
+
+    movers.nw = step_from<G::NW>(OPEN) & NORTH;
+    movers.ne = step_from<G::NE>(OPEN) & NORTH;
+    movers.sw = step_from<G::SW>(OPEN) & SOUTH;
+    movers.se = step_from<G::SE>(OPEN) & SOUTH;
+
+    // determine whether any moves are possible
+    movers.any_action = (movers.nw | movers.ne | movers.sw | movers.se).any();
+
+    return movers;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+Square BasicBoard<G>::get_square_info(int sq) const {
+    Square info {};
+    if (sq < 0 || sq >= G::SIZE) {
+        return info;
+    }
+    
+    // determine color and promotion status
+    info.is_black = m_black.test(sq);
+    info.is_white = m_white.test(sq);
+    info.is_kings = m_kings.test(sq);
+    
+    // look up the actions of whichever piece is here
+    if (info.is_black || info.is_white) {
+        const ActionMap<G> &map = get_cached_map();
+        info.move_nw = map.moves[sq] & 1;
+        info.move_ne = map.moves[sq] & 2;
+        info.move_sw = map.moves[sq] & 4;
+        info.move_se = map.moves[sq] & 8;
+        info.take_nw = map.takes[sq] & 1;
+        info.take_ne = map.takes[sq] & 2;
+        info.take_sw = map.takes[sq] & 4;
+        info.take_se = map.takes[sq] & 8;
+    }
+    
+    return info;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+ActionMap<G> BasicBoard<G>::get_action_map() const {
+    return get_cached_map();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+const ActionMap<G> &BasicBoard<G>::get_cached_map() const {
+
+    // one entry per thread: a front end asks about one position at a time,
+    // and any change to the board makes it a different position, so the
+    // entry never needs explicit invalidation
+    thread_local BasicBoard s_board;
+    thread_local ActionMap<G> s_map;
+    thread_local bool s_valid = false;
+
+    if (!s_valid || !same_position(s_board)) {
+        if (m_turn == BLACK) {
+            build_action_map<BLACK>(s_map);
+        } else {
+            build_action_map<WHITE>(s_map);
+        }
+        s_board = *this;
+        s_valid = true;
+    }
+
+    return s_map;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+template <Color C>
+void BasicBoard<G>::build_action_map(ActionMap<G> &map) const {
+    map = ActionMap<G> {};
+
+    // movers and takers are each computed once for the whole board
+    const Actors<G> TAKERS = get_takers<C>();
+    const Actors<G> MOVERS = TAKERS.any_action ? Actors<G> {} : get_movers<C>();
+
+    // scatter each direction's actors into per-square masks
+    const Position *ACTORS[8] {
+        &MOVERS.nw, &MOVERS.ne, &MOVERS.sw, &MOVERS.se,
+        &TAKERS.nw, &TAKERS.ne, &TAKERS.sw, &TAKERS.se
+    };
+    for (int i = 0; i < 8; ++i) {
+        uint8_t *masks = (i < 4) ? map.moves : map.takes;
+        auto bits = ACTORS[i]->word();
+        while (bits) {
+            masks[lowest_bit(bits)] |= 1 << (i % 4);
+            bits &= bits - 1;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+bool BasicBoard<G>::same_position(const BasicBoard &other) const {
+    return m_black == other.m_black && m_white == other.m_white &&
+           m_kings == other.m_kings && m_turn == other.m_turn &&
+           m_pending == other.m_pending;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+int BasicBoard<G>::player_move(int sq, int dir, Square *info) {
+    
+    // if Square info not provided, calculate Square info
+    Square calculated_info;
+    if (info == nullptr) {
+        calculated_info = get_square_info(sq);
+        info = &calculated_info;
+    }
+    
+    // determine whether specified move is possible
+    bool move_possible;
+    switch (dir) {
+    case G::NW:
+        move_possible = info->move_nw;
+        break;
+    case G::NE:
+        move_possible = info->move_ne;
+        break;
+    case G::SW:
+        move_possible = info->move_sw;
+        break;
+    case G::SE:
+        move_possible = info->move_se;
+        break;
+    default:
+        move_possible = false;
+        break;
+    }
+    
+    // if move is possble, move appropriate pieces
+    if (move_possible) {
+        if (info->is_black) move<BLACK>(sq, dir);
+        if (info->is_white) move<WHITE>(sq, dir);
+        return ACTION_SUCCESS;
+    }
+    
+    return ACTION_FAILURE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+int BasicBoard<G>::player_take(int sq, int dir, Square *info) {
+    
+    // if Square info not provided, calculate Square info
+    Square calculated_info;
+    if (info == nullptr) {
+        calculated_info = get_square_info(sq);
+        info = &calculated_info;
+    }
+    
+    // determine whether specified take is possible
+    bool take_possible;
+    switch (dir) {
+    case G::NW:
+        take_possible = info->take_nw;
+        break;
+    case G::NE:
+        take_possible = info->take_ne;
+        break;
+    case G::SW:
+        take_possible = info->take_sw;
+        break;
+    case G::SE:
+        take_possible = info->take_se;
+        break;
+    default:
+        take_possible = false;
+        break;
+    }
+    
+    // if take is possble, take appropriate pieces
+    if (take_possible) {
+        if (info->is_black) take<BLACK>(sq, dir);
+        if (info->is_white) take<WHITE>(sq, dir);
+        return ACTION_SUCCESS;
+    }
+    
+    return ACTION_FAILURE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+int BasicBoard<G>::player_action(const Action &action) {
+
+    // replay a recorded move or take from its source and destination
+    switch (action.type) {
+    case MOVE:
+        return player_move(action.src, action.dst - action.src);
+    case TAKE:
+        return player_take(action.src, (action.dst - action.src) / 2);
+    default:
+        return ACTION_FAILURE;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+template <Color C>
+std::vector<BasicBoard<G>> BasicBoard<G>::get_actions() const {
+    // left uninitialized: every board the generator writes is a full copy
+    alignas(BasicBoard) unsigned char storage[sizeof(BasicBoard) * MAX_ACTIONS];
+    BasicBoard *actions = reinterpret_cast<BasicBoard *>(storage);
+
+    const int count = get_actions<C>(actions);
+    return std::vector<BasicBoard>(actions, actions + count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+std::vector<BasicBoard<G>> BasicBoard<G>::get_actions(Color turn) const {
+    return (turn == BLACK) ? get_actions<BLACK>() : get_actions<WHITE>();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+template <Color C>
+int BasicBoard<G>::get_actions(BasicBoard *actions) const {
+    
+    // short circuit if it is the other side's turn
+    if (m_turn != C) {
+        return 0;
+    }
+    
+    // calculate movers and takers
+    const Actors<G> MOVERS = get_movers<C>();
+    const Actors<G> TAKERS = get_takers<C>();
+    
+    // calculate all actors
+    const Position ALL_ACTORS =
+        MOVERS.nw | MOVERS.ne | MOVERS.sw | MOVERS.se |
+        TAKERS.nw | TAKERS.ne | TAKERS.sw | TAKERS.se;
+
+    // visit each actor in square order, adding its actions in a fixed order
+    const Position *ACTORS[8] {
+        &MOVERS.nw, &MOVERS.ne, &MOVERS.sw, &MOVERS.se,
+        &TAKERS.nw, &TAKERS.ne, &TAKERS.sw, &TAKERS.se
+    };
+    const int DIRS[4] {G::NW, G::NE, G::SW, G::SE};
+
+    int count = 0;
+    auto bits = ALL_ACTORS.word();
+    while (bits) {
+        const int sq = lowest_bit(bits);
+        bits &= bits - 1;
+
+        for (int i = 0; i < 8; ++i) {
+            if (!ACTORS[i]->test(sq)) {
+                continue;
+            }
+
+            BasicBoard &child = *new (&actions[count++]) BasicBoard(*this);
+            const int dir = DIRS[i % 4];
+            if (i < 4) {
+                child.move<C>(sq, dir);
+            } else {
+                child.take<C>(sq, dir);
+            }
+        }
+    }
+    
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+int BasicBoard<G>::get_actions(Color turn, BasicBoard *actions) const {
+    return (turn == BLACK) ? get_actions<BLACK>(actions)
+                           : get_actions<WHITE>(actions);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <>
+Board Board::ai_black_action(int depth, Backend backend) const {
+    return make_search(backend, BLACK, depth)->best_move(*this);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <>
+Board Board::ai_white_action(int depth, Backend backend) const {
+    return make_search(backend, WHITE, depth)->best_move(*this);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+template <Color C>
+void BasicBoard<G>::end_action(Type type, int src, int dst, bool promoted) {
+
+    // remember the action
+    m_last_color = C;
+    m_last_type = type;
+    m_last_src = src;
+    m_last_dst = dst;
+    m_last_promoted = promoted;
+
+    // a piece that took keeps the turn while it can take again
+    m_turn = C;
+    m_pending = dst;
+    if (type == TAKE && !promoted && get_takers<C>().any_action) {
+        return;
+    }
+
+    // otherwise the turn passes
+    m_turn = ColorTraits<C>::OTHER;
+    m_pending = -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+template <Color C>
+void BasicBoard<G>::move(int sq, int dir) {
+    
+    // set source and destination squares
+    const int src = sq;
+    const int dst = sq + dir;
+    
+    // set whether this action results in a promotion
+    const bool king = m_kings.test(src);
+    const bool promoted = !king && PROMOTION_ROW<G, C>.test(dst);
+    
+    // perform the move, carrying the crown with a king
+    Position &own = get_side<C>();
+    own.reset(src);
+    own.set(dst);
+    if (king) {
+        m_kings.reset(src);
+        m_kings.set(dst);
+    }
+    
+    // update kings if piece lands in the promotion row
+    m_kings = m_kings | (own & PROMOTION_ROW<G, C>);
+    
+    end_action<C>(MOVE, src, dst, promoted);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename G>
+template <Color C>
+void BasicBoard<G>::take(int sq, int dir) {
+    
+    // set source, destination, captured squares
+    const int src = sq;
+    const int dst = sq + (2 * dir);
+    const int CAPTURED = sq + dir;
+    
+    // set whether this action results in a promotion
+    const bool king = m_kings.test(src);
+    const bool promoted = !king && PROMOTION_ROW<G, C>.test(dst);
+    
+    // perform the take, carrying the crown with a king
+    Position &own = get_side<C>();
+    own.reset(src);
+    get_side<ColorTraits<C>::OTHER>().reset(CAPTURED);
+    m_kings.reset(CAPTURED);
+    own.set(dst);
+    if (king) {
+        m_kings.reset(src);
+        m_kings.set(dst);
+    }
+    
+    // update kings if piece lands in the promotion row
+    m_kings = m_kings | (own & PROMOTION_ROW<G, C>);
+    
+    end_action<C>(TAKE, src, dst, promoted);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+GameRecord::GameRecord(const Board &start) : m_start(start), m_board(start) {}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int GameRecord::play(const Action &action) {
+    Board next = m_board;
+    if (next.player_action(action) != ACTION_SUCCESS) {
+        return ACTION_FAILURE;
+    }
+
+    append(next);
+    return ACTION_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void GameRecord::append(const Board &next) {
+    m_history.push_back(next.get_last_action());
+    m_board = next;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const Board &GameRecord::get_start() const {
+    return m_start;
+}
+
+const Board &GameRecord::get_board() const {
+    return m_board;
+}
+
+const History &GameRecord::get_history() const {
+    return m_history;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Compile each geometry in full.
+template class BasicBoard<EnglishGeometry>;
+template class BasicBoard<Geometry10x10>;
+
+template std::vector<Board> Board::get_actions<BLACK>() const;
+template std::vector<Board> Board::get_actions<WHITE>() const;
+template std::vector<Board10x10> Board10x10::get_actions<BLACK>() const;
+template std::vector<Board10x10> Board10x10::get_actions<WHITE>() const;
+template int Board::get_actions<BLACK>(Board *) const;
+template int Board::get_actions<WHITE>(Board *) const;
+template int Board10x10::get_actions<BLACK>(Board10x10 *) const;
+template int Board10x10::get_actions<WHITE>(Board10x10 *) const;
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,143 @@
+/* -----------------------------------------------------------------------------
+draw.cc
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "engine/draw.hh"
+#include "engine/board.hh"
+
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool is_reversible(const Board &board) {
+
+    // only a king can step back to where it was; a man promoting cannot
+    const Action action = board.get_last_action();
+    return action.type == MOVE && !action.promoted &&
+           board.get_kings().test(action.dst);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+KeyStack::KeyStack() : m_counts(1 << FILTER_BITS) {}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void KeyStack::assign(const GameRecord &game) {
+    clear();
+    reserve(game.get_history().size() + 1);
+
+    // a game's boards do not outlive this call, so each is hashed now
+    Board board = game.get_start();
+    for (size_t i = 0; ; ++i) {
+        push(board);
+        Entry &top = m_entries.back();
+        if (!top.keyed) {
+            set_key(top, board.get_key());
+        }
+        top.board = nullptr;
+
+        if (i == game.get_history().size() ||
+            board.player_action(game.get_history()[i]) != ACTION_SUCCESS) {
+            break;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void KeyStack::push(const Board &board) {
+    m_entries.push_back(Entry {0, &board, 0, false});
+    Entry &top = m_entries.back();
+    if (m_entries.size() == 1 || !is_reversible(board)) {
+        return;
+    }
+
+    // a reversible ply extends the window of positions that can repeat...
+    top.reversible = m_entries[m_entries.size() - 2].reversible + 1;
+    set_key(top, board.get_key());
+
+    // ...back to the first, which was left unhashed if it was irreversible
+    Entry &first = m_entries[m_entries.size() - 1 - top.reversible];
+    if (!first.keyed) {
+        set_key(first, first.board->get_key());
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void KeyStack::pop() {
+    const Entry &top = m_entries.back();
+    if (top.keyed) {
+        --m_counts[top.key & ((1 << FILTER_BITS) - 1)];
+    }
+    m_entries.pop_back();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void KeyStack::clear() {
+    while (!m_entries.empty()) {
+        pop();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void KeyStack::reserve(size_t size) {
+    m_entries.reserve(size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+size_t KeyStack::size() const {
+    return m_entries.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int KeyStack::reversible() const {
+    return m_entries.empty() ? 0 : m_entries.back().reversible;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int KeyStack::repetitions() const {
+    if (m_entries.empty()) {
+        return 0;
+    }
+
+    // an unhashed or unique key cannot repeat
+    const Entry &top = m_entries.back();
+    if (!top.keyed || m_counts[top.key & ((1 << FILTER_BITS) - 1)] < 2) {
+        return 0;
+    }
+
+    // plies alternate sides within the window, so only every other
+    // position has the same side to move
+    int count = 0;
+    const size_t last = m_entries.size() - 1;
+    for (int back = 2; back <= top.reversible; back += 2) {
+        count += (m_entries[last - back].key == top.key);
+    }
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool KeyStack::is_draw() const {
+    return reversible() >= DRAW_PLIES || repetitions() > 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void KeyStack::set_key(Entry &entry, uint64_t key) {
+    entry.key = key;
+    entry.keyed = true;
+    ++m_counts[key & ((1 << FILTER_BITS) - 1)];
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -1,16 +1,80 @@
-/* -----------------------------------------------------------------------------
-engine.cc
-
-Name: Joseph Sturm
-Date: 01/27/2020
------------------------------------------------------------------------------ */
-
-#include "engine/engine.hh"
-
-////////////////////////////////////////////////////////////////////////////////
-
-int main() {
-    return 0;
-}
-
-////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
+/* -----------------------------------------------------------------------------
+engine.cc
+
+Starts the engine:
+    engine [--book <file>] [--weights <file>] [--cache <file>] [--cache-mb <n>]
+           [--trace <file>] [--trace-rate <n>]
+
+The analysis cache persists search results between runs and is shared with
+any other engine using the same file. A trace (see trace.hh) records what
+every search does, tracing one node in n; convert it with the trace tool.
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "engine/engine.hh"
+#include "ai/book.hh"
+#include "ai/cache.hh"
+#include "ai/evaluate.hh"
+#include "ai/search.hh"
+#include "ai/trace.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv) {
+
+    // the opening book and cache stay mapped for the life of the process
+    static Book book;
+    static AnalysisCache cache;
+    const char *cache_path = nullptr;
+    size_t cache_mb = CACHE_DEFAULT_MB;
+    const char *trace_path = nullptr;
+    uint32_t trace_rate = TRACE_DEFAULT_RATE;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--book") == 0) {
+            if (book.open(argv[i + 1]) == ACTION_SUCCESS) {
+                Search::use_book(&book);
+            } else {
+                std::fprintf(stderr, "failed to open book %s\n", argv[i + 1]);
+            }
+        } else if (std::strcmp(argv[i], "--weights") == 0) {
+            Weights weights;
+            if (load_weights(argv[i + 1], weights) == ACTION_SUCCESS) {
+                set_weights(weights);
+            } else {
+                std::fprintf(stderr, "failed to load weights %s\n", argv[i + 1]);
+            }
+        } else if (std::strcmp(argv[i], "--cache") == 0) {
+            cache_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--cache-mb") == 0) {
+            cache_mb = std::strtoul(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--trace") == 0) {
+            trace_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--trace-rate") == 0) {
+            trace_rate = std::strtoul(argv[i + 1], nullptr, 10);
+        }
+    }
+
+    // opening an existing cache warm-starts every search from it
+    if (cache_path) {
+        if (cache.open(cache_path, cache_mb) == ACTION_SUCCESS) {
+            Search::use_cache(&cache);
+        } else {
+            std::fprintf(stderr, "failed to open cache %s\n", cache_path);
+        }
+    }
+
+    if (trace_path && start_trace(trace_path, trace_rate) != ACTION_SUCCESS) {
+        std::fprintf(stderr, "failed to create trace %s\n", trace_path);
+    }
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
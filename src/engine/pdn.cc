@@ -0,0 +1,486 @@
+/* -----------------------------------------------------------------------------
+pdn.cc
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "engine/pdn.hh"
+#include "engine/board.hh"
+#include "engine/record.hh"
+
+#include <cctype>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Lines of movetext are wrapped at this width.
+const auto PDN_LINE_WIDTH {80};
+
+////////////////////////////////////////////////////////////////////////////////
+
+int pdn_to_square(int num) {
+    if (num < 1 || num > 32) {
+        return -1;
+    }
+
+    // rows of four squares, numbered right to left from black's side
+    const int row = (num - 1) / 4;
+    const int col = 3 - (num - 1) % 4;
+    return 5 + 9 * (row / 2) + 5 * (row % 2) + col;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int square_to_pdn(int sq) {
+    for (int num = 1; num <= 32; ++num) {
+        if (pdn_to_square(num) == sq) {
+            return num;
+        }
+    }
+
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::string write_action(const Action &action) {
+    return std::to_string(square_to_pdn(action.src)) +
+           ((action.type == TAKE) ? "x" : "-") +
+           std::to_string(square_to_pdn(action.dst));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int parse_fen(const std::string &fen, Board &state) {
+    Position black = EMPTY_BOARD;
+    Position white = EMPTY_BOARD;
+    Position kings = EMPTY_BOARD;
+
+    // strip the optional trailing period
+    std::string text = fen;
+    if (!text.empty() && text.back() == '.') {
+        text.pop_back();
+    }
+
+    // the first field is the side to move
+    std::stringstream fields(text);
+    std::string field;
+    if (!std::getline(fields, field, ':') || field.size() != 1 ||
+        (field[0] != 'B' && field[0] != 'W')) {
+
+        return ACTION_FAILURE;
+    }
+    const Color turn = (field[0] == 'B') ? BLACK : WHITE;
+
+    // each further field lists one color's pieces: "W18,K22,1-4"
+    while (std::getline(fields, field, ':')) {
+        if (field.empty() || (field[0] != 'B' && field[0] != 'W')) {
+            return ACTION_FAILURE;
+        }
+        Position &pieces = (field[0] == 'B') ? black : white;
+
+        std::stringstream squares(field.substr(1));
+        std::string item;
+        while (std::getline(squares, item, ',')) {
+            const bool king = !item.empty() && item[0] == 'K';
+            if (king) {
+                item.erase(0, 1);
+            }
+
+            int first = 0;
+            int last = 0;
+            const size_t dash = item.find('-');
+            try {
+                first = std::stoi(item.substr(0, dash));
+                last = (dash == std::string::npos) ? first
+                                                   : std::stoi(item.substr(dash + 1));
+            } catch (...) {
+                return ACTION_FAILURE;
+            }
+
+            for (int num = first; num <= last; ++num) {
+                const int sq = pdn_to_square(num);
+                if (sq < 0) {
+                    return ACTION_FAILURE;
+                }
+                pieces.set(sq);
+                if (king) {
+                    kings.set(sq);
+                }
+            }
+        }
+    }
+
+    state = Board(black, white, kings, turn);
+    return ACTION_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::string write_fen(const Board &state) {
+    std::string fen = (state.get_turn() == BLACK) ? "B" : "W";
+
+    // list white then black pieces in square order
+    const Position *sides[2] {&state.get_white(), &state.get_black()};
+    const char names[2] {'W', 'B'};
+    for (int i = 0; i < 2; ++i) {
+        fen += ':';
+        fen += names[i];
+
+        bool first = true;
+        for (int num = 1; num <= 32; ++num) {
+            const int sq = pdn_to_square(num);
+            if (!sides[i]->test(sq)) {
+                continue;
+            }
+
+            if (!first) fen += ',';
+            if (state.get_kings().test(sq)) fen += 'K';
+            fen += std::to_string(num);
+            first = false;
+        }
+    }
+
+    return fen;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Finds a (possibly multi-hop) take from src to dst by searching all paths,
+// appending the board after each hop.
+bool take_path(const Board &state, int src, int dst, std::vector<Board> &hops) {
+    const Color turn = state.get_turn();
+    const Neighbors &near = NEIGHBORS<EnglishGeometry>[src];
+
+    for (int i = 0; i < 4; ++i) {
+        const int land = near.jump[i];
+        if (land == OFF_BOARD) {
+            continue;
+        }
+
+        Board next = state;
+        if (next.player_take(src, EnglishGeometry::DIRS[i]) != ACTION_SUCCESS) {
+            continue;
+        }
+
+        // stop at the destination, or keep taking with the same piece
+        hops.push_back(next);
+        if (land == dst ||
+            (next.get_turn() == turn && take_path(next, land, dst, hops))) {
+
+            return true;
+        }
+        hops.pop_back();
+    }
+
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Converts a result token, returning false if the token is not a result.
+bool parse_result(const std::string &token, Result &result) {
+    if (token == "1-0" || token == "2-0") {
+        result = BLACK_WIN;
+    } else if (token == "0-1" || token == "0-2") {
+        result = WHITE_WIN;
+    } else if (token == "1/2-1/2" || token == "1-1") {
+        result = DRAW;
+    } else if (token == "*") {
+        result = UNKNOWN;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Plays a PDN move ("11-15", "15x24x31" or "15:24") on a game.
+int play_pdn_move(GameRecord &game, const std::string &token) {
+    const bool take = token.find_first_of("x:") != std::string::npos;
+
+    // split the token into PDN square numbers
+    std::vector<int> squares;
+    int num = 0;
+    bool digits = false;
+    for (const char c : token) {
+        if (std::isdigit((unsigned char)c)) {
+            num = num * 10 + (c - '0');
+            digits = true;
+        } else if (digits) {
+            squares.push_back(pdn_to_square(num));
+            num = 0;
+            digits = false;
+        }
+    }
+    if (digits) {
+        squares.push_back(pdn_to_square(num));
+    }
+
+    if (squares.size() < 2) {
+        return ACTION_FAILURE;
+    }
+    for (const int sq : squares) {
+        if (sq < 0) return ACTION_FAILURE;
+    }
+
+    const Board &state = game.get_board();
+    if (!take) {
+        return (squares.size() == 2)
+            ? game.play(Action {state.get_turn(), MOVE,
+                                squares[0], squares[1], false})
+            : ACTION_FAILURE;
+    }
+
+    // each listed square is reached by one or more hops; the board hopped
+    // from is copied, as take_path appends to (and may reallocate) "hops"
+    std::vector<Board> hops;
+    for (size_t i = 1; i < squares.size(); ++i) {
+        const Board from = hops.empty() ? state : hops.back();
+        if (!take_path(from, squares[i - 1], squares[i], hops)) {
+            return ACTION_FAILURE;
+        }
+    }
+
+    for (const auto &hop : hops) {
+        game.append(hop);
+    }
+    return ACTION_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+PdnReader::PdnReader(std::istream &in) : m_in(in) {}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool PdnReader::next_token(std::string &token, std::string &tag) {
+    token.clear();
+    tag.clear();
+
+    int depth = 0;
+    char c;
+    while (m_in.get(c)) {
+
+        // skip comments and (possibly nested) variations
+        if (c == '{') {
+            while (m_in.get(c) && c != '}') {}
+            continue;
+        }
+        if (c == ';') {
+            while (m_in.get(c) && c != '\n') {}
+            continue;
+        }
+        if (c == '(') {
+            ++depth;
+            continue;
+        }
+        if (c == ')') {
+            if (depth > 0) --depth;
+            continue;
+        }
+        if (depth > 0 || std::isspace((unsigned char)c)) {
+            if (!token.empty()) return true;
+            continue;
+        }
+
+        // read a whole tag pair: [Name "value"]
+        if (c == '[') {
+            if (!token.empty()) {
+                m_in.unget();
+                return true;
+            }
+            while (m_in.get(c) && c != ']') {
+                if (c == '"') {
+                    tag += c;
+                    while (m_in.get(c) && c != '"') tag += c;
+                }
+                tag += c;
+            }
+            return true;
+        }
+
+        token += c;
+    }
+
+    return !token.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool PdnReader::next(Game &game) {
+    game = Game();
+    GameRecord record;
+    bool started = false;
+    bool moves = false;
+
+    std::string token;
+    std::string tag = m_pending_tag;
+    m_pending_tag.clear();
+
+    while (!tag.empty() || next_token(token, tag)) {
+
+        // tags: a tag after movetext belongs to the next game
+        if (!tag.empty()) {
+            if (moves || game.error) {
+                m_pending_tag = tag;
+                break;
+            }
+
+            const size_t open = tag.find('"');
+            const size_t close = tag.rfind('"');
+            const std::string name = tag.substr(0, tag.find_first_of(" \t\""));
+            const std::string value = (open != close)
+                ? tag.substr(open + 1, close - open - 1) : "";
+
+            Board board;
+            if (name == "FEN" && parse_fen(value, board) == ACTION_SUCCESS) {
+                game.start = board;
+                record = GameRecord(board);
+            } else if (name == "Result") {
+                parse_result(value, game.result);
+            }
+
+            started = true;
+            tag.clear();
+            continue;
+        }
+
+        started = true;
+
+        // a result token ends the game
+        if (parse_result(token, game.result)) {
+            break;
+        }
+
+        // strip move numbers ("12." or "12..."), possibly fused to a move
+        const size_t dot = token.find_last_of('.');
+        if (dot != std::string::npos) {
+            token.erase(0, dot + 1);
+        }
+        if (token.empty() || !std::isdigit((unsigned char)token[0])) {
+            continue;
+        }
+
+        // after a bad move the rest of the movetext is skipped, not read
+        // as another game
+        if (game.error) {
+            continue;
+        }
+        if (play_pdn_move(record, token) != ACTION_SUCCESS) {
+            game.error = true;
+            continue;
+        }
+        moves = true;
+    }
+
+    game.history = record.get_history();
+    return started;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+PdnWriter::PdnWriter(std::ostream &out) : m_out(out) {}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void PdnWriter::write(const Game &game) {
+    static const char *RESULTS[] {"*", "1-0", "0-1", "1/2-1/2"};
+    const char *result = RESULTS[game.result];
+
+    // tags
+    m_out << "[Event \"?\"]\n";
+    m_out << "[Result \"" << result << "\"]\n";
+    if (game.start.get_black() != BLACK_START ||
+        game.start.get_white() != WHITE_START ||
+        game.start.get_kings() != EMPTY_BOARD ||
+        game.start.get_turn() != BLACK) {
+
+        m_out << "[FEN \"" << write_fen(game.start) << "\"]\n";
+    }
+    m_out << "\n";
+
+    // group hops into PDN moves, numbering each black move
+    std::string line;
+    int number = 1;
+    for (size_t i = 0; i < game.history.size(); ) {
+        const Action &first = game.history[i];
+
+        std::string text;
+        if (first.color == BLACK) {
+            text = std::to_string(number++) + ". ";
+        } else if (i == 0) {
+            text = std::to_string(number++) + "... ";
+        }
+
+        text += std::to_string(square_to_pdn(first.src));
+        if (first.type == MOVE) {
+            text += "-" + std::to_string(square_to_pdn(first.dst));
+            ++i;
+        } else {
+            // a take continues while the same color keeps taking
+            size_t j = i;
+            do {
+                text += "x" + std::to_string(square_to_pdn(game.history[j].dst));
+                ++j;
+            } while (j < game.history.size() &&
+                     game.history[j].color == first.color &&
+                     game.history[j].type == TAKE &&
+                     game.history[j].src == game.history[j - 1].dst);
+            i = j;
+        }
+
+        if (!line.empty() && line.size() + text.size() + 1 > PDN_LINE_WIDTH) {
+            m_out << line << "\n";
+            line.clear();
+        }
+        line += (line.empty() ? "" : " ") + text;
+    }
+
+    if (!line.empty() && line.size() + 8 > PDN_LINE_WIDTH) {
+        m_out << line << "\n";
+        line.clear();
+    }
+    m_out << line << (line.empty() ? "" : " ") << result << "\n\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int GameSource::open(const std::string &path) {
+    m_pdn.reset();
+    m_record.close();
+
+    // PDN is recognized by extension, anything else is a binary record
+    const bool pdn = path.size() >= 4 &&
+                     path.compare(path.size() - 4, 4, ".pdn") == 0;
+    if (!pdn) {
+        return m_record.open(path);
+    }
+
+    m_text.open(path);
+    if (!m_text) {
+        return ACTION_FAILURE;
+    }
+
+    m_pdn.reset(new PdnReader(m_text));
+    return ACTION_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool GameSource::next(Game &game) {
+    if (m_pdn) {
+        return m_pdn->next(game);
+    }
+
+    return m_record.next(game);
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,326 @@
+/* -----------------------------------------------------------------------------
+record.cc
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "engine/record.hh"
+#include "engine/board.hh"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Closes the index of a record file.
+struct RecordFooter {
+    uint64_t index;
+    uint64_t count;
+    char magic[4];
+    uint32_t version;
+};
+
+// Stores a custom starting position.
+struct RecordStart {
+    uint64_t black, white, kings;
+    uint8_t turn;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+int encode_action(const Board &state, const Action &action) {
+
+    // left uninitialized: every board the generator writes is a full copy
+    alignas(Board) unsigned char storage[sizeof(Board) * Board::MAX_ACTIONS];
+    Board *actions = reinterpret_cast<Board *>(storage);
+    const int count = state.get_actions(state.get_turn(), actions);
+
+    // actions are generated in a fixed order, so an index identifies one
+    for (int i = 0; i < count; ++i) {
+        const Action taken = actions[i].get_last_action();
+        if (taken.src == action.src && taken.dst == action.dst) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int decode_action(Board &state, int index) {
+    alignas(Board) unsigned char storage[sizeof(Board) * Board::MAX_ACTIONS];
+    Board *actions = reinterpret_cast<Board *>(storage);
+    const int count = state.get_actions(state.get_turn(), actions);
+
+    if (index < 0 || index >= count) {
+        return ACTION_FAILURE;
+    }
+
+    state = actions[index];
+    return ACTION_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+GameWriter::~GameWriter() {
+    close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int GameWriter::open(const std::string &path) {
+    close();
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        return ACTION_FAILURE;
+    }
+
+    // write the file header
+    const uint32_t version = RECORD_VERSION;
+    if (std::fwrite(RECORD_MAGIC, sizeof(RECORD_MAGIC), 1, m_file) != 1 ||
+        std::fwrite(&version, sizeof(version), 1, m_file) != 1) {
+
+        close();
+        return ACTION_FAILURE;
+    }
+
+    return ACTION_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int GameWriter::close() {
+    if (!m_file) {
+        return ACTION_SUCCESS;
+    }
+
+    // append the index and footer after the last game
+    RecordFooter footer {};
+    footer.index = std::ftell(m_file);
+    footer.count = m_offsets.size();
+    std::memcpy(footer.magic, RECORD_MAGIC, sizeof(RECORD_MAGIC));
+    footer.version = RECORD_VERSION;
+
+    bool ok = m_offsets.empty() ||
+        std::fwrite(m_offsets.data(), sizeof(uint64_t),
+                    m_offsets.size(), m_file) == m_offsets.size();
+    ok = ok && std::fwrite(&footer, sizeof(footer), 1, m_file) == 1;
+    ok = (std::fclose(m_file) == 0) && ok;
+
+    m_file = nullptr;
+    m_offsets.clear();
+
+    return ok ? ACTION_SUCCESS : ACTION_FAILURE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int GameWriter::write(const Game &game) {
+    if (!m_file || game.history.size() > UINT16_MAX) {
+        return ACTION_FAILURE;
+    }
+
+    // the default start is implied, any other start is stored
+    const Board standard;
+    const bool custom =
+        game.start.get_black() != standard.get_black() ||
+        game.start.get_white() != standard.get_white() ||
+        game.start.get_kings() != standard.get_kings() ||
+        game.start.get_turn() != standard.get_turn();
+
+    GameHeader header {};
+    header.result = game.result;
+    header.flags = custom ? CUSTOM_START : 0;
+    header.plies = game.history.size();
+
+    // encode every action by replaying the game
+    std::vector<uint8_t> encoded;
+    encoded.reserve(header.plies);
+    Board board = game.start;
+    for (const auto &action : game.history) {
+        const int index = encode_action(board, action);
+        if (index < 0 || index > UINT8_MAX) {
+            return ACTION_FAILURE;
+        }
+
+        encoded.push_back(index);
+        decode_action(board, index);
+    }
+
+    m_offsets.push_back(std::ftell(m_file));
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, m_file) == 1;
+    if (custom) {
+        RecordStart start {};
+        start.black = game.start.get_black().to_ullong();
+        start.white = game.start.get_white().to_ullong();
+        start.kings = game.start.get_kings().to_ullong();
+        start.turn = game.start.get_turn();
+        ok = ok && std::fwrite(&start, sizeof(start), 1, m_file) == 1;
+    }
+    if (!encoded.empty()) {
+        ok = ok && std::fwrite(encoded.data(), 1, encoded.size(), m_file) ==
+                   encoded.size();
+    }
+
+    return ok ? ACTION_SUCCESS : ACTION_FAILURE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+GameReader::~GameReader() {
+    close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int GameReader::open(const std::string &path) {
+    close();
+
+    m_file = std::fopen(path.c_str(), "rb");
+    if (!m_file) {
+        return ACTION_FAILURE;
+    }
+
+    // check the file header
+    char magic[4];
+    uint32_t version;
+    if (std::fread(magic, sizeof(magic), 1, m_file) != 1 ||
+        std::fread(&version, sizeof(version), 1, m_file) != 1 ||
+        std::memcmp(magic, RECORD_MAGIC, sizeof(magic)) != 0 ||
+        version != RECORD_VERSION) {
+
+        close();
+        return ACTION_FAILURE;
+    }
+
+    // a file that was not closed cleanly has no footer; read to its end
+    RecordFooter footer {};
+    std::fseek(m_file, -(long)sizeof(footer), SEEK_END);
+    const long size = std::ftell(m_file) + sizeof(footer);
+    if (std::fread(&footer, sizeof(footer), 1, m_file) == 1 &&
+        std::memcmp(footer.magic, RECORD_MAGIC, sizeof(magic)) == 0 &&
+        footer.index + footer.count * sizeof(uint64_t) + sizeof(footer) ==
+        (uint64_t)size) {
+
+        m_end = footer.index;
+        m_count = footer.count;
+        m_indexed = true;
+    } else {
+        m_end = size;
+    }
+
+    std::fseek(m_file, sizeof(magic) + sizeof(version), SEEK_SET);
+    return ACTION_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void GameReader::close() {
+    if (m_file) {
+        std::fclose(m_file);
+    }
+
+    m_file = nullptr;
+    m_end = 0;
+    m_count = 0;
+    m_read = 0;
+    m_indexed = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+uint64_t GameReader::size() const {
+    return m_count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int GameReader::seek(uint64_t n) {
+    if (!m_file || !m_indexed || n >= m_count) {
+        return ACTION_FAILURE;
+    }
+
+    // look up the game's offset in the on-disk index
+    uint64_t offset;
+    std::fseek(m_file, m_end + n * sizeof(uint64_t), SEEK_SET);
+    if (std::fread(&offset, sizeof(offset), 1, m_file) != 1) {
+        return ACTION_FAILURE;
+    }
+
+    std::fseek(m_file, offset, SEEK_SET);
+    m_read = n;
+    return ACTION_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool GameReader::next(Game &game) {
+    if (!m_file || (uint64_t)std::ftell(m_file) >= m_end) {
+        return false;
+    }
+
+    GameHeader header;
+    if (std::fread(&header, sizeof(header), 1, m_file) != 1) {
+        return false;
+    }
+    ++m_read;
+
+    // read the starting position and the actions; in an indexed file, a
+    // record cut short or running into the index is corrupt, not the end
+    game.start = Board();
+    bool whole = true;
+    if (header.flags & CUSTOM_START) {
+        RecordStart start;
+        whole = std::fread(&start, sizeof(start), 1, m_file) == 1;
+        game.start = Board(Position(start.black), Position(start.white),
+                           Position(start.kings), (Color)start.turn);
+    }
+
+    m_buffer.resize(header.plies);
+    whole = whole && (header.plies == 0 ||
+        std::fread(m_buffer.data(), 1, header.plies, m_file) == header.plies);
+    whole = whole && (uint64_t)std::ftell(m_file) <= m_end;
+    if (!whole) {
+        if (!m_indexed) {
+            return false;
+        }
+        game.start = Board();
+        m_buffer.clear();
+    }
+
+    // a game that does not replay is kept up to its bad action and marked
+    game.error = !whole || header.result > DRAW;
+    GameRecord record(game.start);
+    Board board = game.start;
+    for (const uint8_t index : m_buffer) {
+        if (decode_action(board, index) != ACTION_SUCCESS) {
+            game.error = true;
+            break;
+        }
+        record.append(board);
+    }
+
+    game.history = record.get_history();
+    game.result = (header.result <= DRAW) ? (Result)header.result : UNKNOWN;
+
+    // a corrupt header may have read into the next game, so resume at the
+    // next index entry when there is an index
+    if (game.error && m_indexed) {
+        if (m_read < m_count) {
+            seek(m_read);
+        } else {
+            std::fseek(m_file, m_end, SEEK_SET);
+        }
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
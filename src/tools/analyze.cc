@@ -0,0 +1,224 @@
+/* -----------------------------------------------------------------------------
+analyze.cc
+
+Scores a stream of positions in parallel, writing results in input order:
+    analyze <input> [depth] [seconds] [threads] [cache] [trace]
+
+The input is either a text file with one position per line,
+    <fen> [depth] [seconds]
+where the optional fields override the defaults for that position, or a game
+file (".pdn" or ".cgr") whose every position is analyzed.
+
+Given a cache file (see cache.hh), results are shared with earlier runs and
+with other analyzers using the same file; a position already searched deep
+enough is answered without searching ("-" for no cache). Given a trace file,
+every search is traced (see trace.hh), one node in TRACE_DEFAULT_RATE.
+
+Each output line is tab-separated:
+    index, fen, score (black's view), best move, PV, nodes, depth, milliseconds,
+    search statistics
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "ai/cache.hh"
+#include "ai/minmax.hh"
+#include "ai/stats.hh"
+#include "ai/trace.hh"
+#include "engine/board.hh"
+#include "engine/pdn.hh"
+#include "engine/record.hh"
+#include "util/thread_pool.hh"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Results may finish at most this far ahead of the oldest unwritten one.
+const long REORDER_WINDOW {4096};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Writes results strictly in input order as they complete out of order.
+class Sequencer {
+    std::map<long, std::string> m_ready;
+    long m_next = 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_written;
+
+public:
+    // blocks until result "index" is close enough to the output position
+    void reserve(long index) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_written.wait(lock, [&] { return index - m_next < REORDER_WINDOW; });
+    }
+
+    // stores a result and writes every result now in order
+    void finish(long index, std::string line) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ready.emplace(index, std::move(line));
+
+        while (!m_ready.empty() && m_ready.begin()->first == m_next) {
+            std::fputs(m_ready.begin()->second.c_str(), stdout);
+            m_ready.erase(m_ready.begin());
+            ++m_next;
+        }
+
+        m_written.notify_all();
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Searches one position and formats its result line.
+std::string analyze(long index, const Board &state, const Limits &limits) {
+    const auto start = std::chrono::steady_clock::now();
+
+    MinMax computer(state.get_turn(), limits.depth);
+    const SearchResult result = computer.search(state, limits);
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    std::string pv;
+    for (const auto &action : result.pv) {
+        pv += (pv.empty() ? "" : " ") + write_action(action);
+    }
+
+    char numbers[128];
+    std::snprintf(numbers, sizeof(numbers), "%.3f", result.score);
+
+    std::string line = std::to_string(index) + "\t" + write_fen(state) + "\t" +
+                       numbers + "\t" +
+                       (result.pv.empty() ? "-" : write_action(result.pv[0])) +
+                       "\t" + pv + "\t" + std::to_string(result.nodes) + "\t" +
+                       std::to_string(result.depth) + "\t" +
+                       std::to_string(elapsed.count()) + "\t" +
+                       format_stats(result.stats) + "\n";
+    return line;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Calls "visit" on every position of the input file.
+int read_positions(const std::string &path, const Limits &defaults,
+                   const std::function<void(const Board &, const Limits &)> &visit) {
+    const bool games =
+        path.size() >= 4 && (path.compare(path.size() - 4, 4, ".pdn") == 0 ||
+                             path.compare(path.size() - 4, 4, ".cgr") == 0);
+
+    // game files: replay each game, visiting every position
+    if (games) {
+        GameSource source;
+        if (source.open(path) != ACTION_SUCCESS) {
+            return ACTION_FAILURE;
+        }
+
+        Game game;
+        while (source.next(game)) {
+            Board board = game.start;
+            visit(board, defaults);
+            for (const auto &action : game.history) {
+                if (board.player_action(action) != ACTION_SUCCESS) break;
+                visit(board, defaults);
+            }
+        }
+        return ACTION_SUCCESS;
+    }
+
+    // text files: one FEN per line with optional limits
+    std::ifstream in(path);
+    if (!in) {
+        return ACTION_FAILURE;
+    }
+
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string fen;
+        if (!(fields >> fen) || fen[0] == '#') {
+            continue;
+        }
+
+        Limits limits = defaults;
+        fields >> limits.depth >> limits.seconds;
+
+        Board board;
+        if (parse_fen(fen, board) != ACTION_SUCCESS) {
+            std::fprintf(stderr, "skipped bad position: %s\n", fen.c_str());
+            continue;
+        }
+        visit(board, limits);
+    }
+
+    return ACTION_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::fprintf(stderr,
+                     "usage: %s <input> [depth] [seconds] [threads] [cache] "
+                     "[trace]\n",
+                     argv[0]);
+        return 1;
+    }
+
+    Limits defaults;
+    defaults.depth = (argc > 2) ? std::atoi(argv[2]) : 6;
+    defaults.seconds = (argc > 3) ? std::atof(argv[3]) : 0;
+    const unsigned threads = (argc > 4) ? std::atoi(argv[4]) : 0;
+
+    AnalysisCache cache;
+    if (argc > 5 && std::string(argv[5]) != "-") {
+        if (cache.open(argv[5]) != ACTION_SUCCESS) {
+            std::fprintf(stderr, "failed to open cache %s\n", argv[5]);
+            return 1;
+        }
+        Search::use_cache(&cache);
+    }
+
+    if (argc > 6 && start_trace(argv[6]) != ACTION_SUCCESS) {
+        std::fprintf(stderr, "failed to create trace %s\n", argv[6]);
+        return 1;
+    }
+
+    // fan positions out to the pool as they are read
+    ThreadPool pool(threads);
+    Sequencer output;
+    long index = 0;
+
+    const int status = read_positions(argv[1], defaults,
+        [&](const Board &state, const Limits &limits) {
+            const long i = index++;
+            output.reserve(i);
+            pool.submit([&output, i, state, limits] {
+                output.finish(i, analyze(i, state, limits));
+            });
+        });
+
+    pool.wait();
+    std::fflush(stdout);
+    stop_trace();
+
+    if (status != ACTION_SUCCESS) {
+        std::fprintf(stderr, "failed to read %s\n", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,646 @@
+/* -----------------------------------------------------------------------------
+bench.cc
+
+Times the engine's hot paths over fixed opening, middlegame and king endgame
+positions, and compares the results against a stored baseline:
+    bench [--save <file>] [--baseline <file>] [--threshold <fraction>]
+
+Results are printed one JSON object per line,
+    {"name": "evaluate", "ns_per_op": 41.2, "ops": 1200000}
+and a saved results file can later be passed as the baseline. Any benchmark
+slower than its baseline by more than the threshold (default 0.10) is flagged
+and makes the exit status non-zero. The analysis cache is timed on a small
+temporary file.
+
+The bench build also counts heap allocations: a search must make none per
+node once it is set up, and any that it does is reported and fails the run.
+Likewise every block move generation kernel the CPU supports is checked
+against Board::get_actions, and any disagreement fails the run, as does any
+game that does not read back from PDN exactly as it was written.
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "ai/book.hh"
+#include "ai/cache.hh"
+#include "ai/evaluate.hh"
+#include "ai/mcts.hh"
+#include "ai/minmax.hh"
+#include "ai/search.hh"
+#include "engine/block.hh"
+#include "engine/board.hh"
+#include "engine/pdn.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Each benchmark is repeated and the fastest run is reported (least noisy).
+const auto BENCH_RUNS {5};
+
+// Minimum length of one run.
+const double BENCH_SECONDS {0.1};
+
+// Depth of the fixed-depth search benchmark.
+const auto BENCH_DEPTH {5};
+
+// Representative positions: opening, middlegame and king endgame.
+const char *const BENCH_POSITIONS[] {
+    "B:W21,22,23,24,25,26,27,28,29,30,31,32:B1,2,3,4,5,6,7,8,9,10,11,12",
+    "B:W17,19,21,22,23,25,26,27,29,30,31:B1,2,3,5,6,7,9,10,11,14,16",
+    "W:WK10,K15,18,24,27,28:B12,16,20,K22,K25,K29",
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The time per operation of one benchmark.
+struct BenchResult {
+    std::string name;
+    double ns_per_op;
+    long ops;
+};
+
+// Keeps results alive so the compiler cannot discard benchmarked work.
+volatile uint64_t sink;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Heap allocations made so far, counted by the replacement operator new.
+std::atomic<long> allocations {0};
+
+// Every replacement operator new and delete goes through this pair, kept out
+// of line so the compiler pairs each new with a delete rather than with the
+// malloc and free inside.
+[[gnu::noinline]] void *allocate(size_t size, size_t alignment) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    // aligned_alloc wants a multiple of the alignment
+    size = size ? size : 1;
+    void *memory = (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        ? std::malloc(size)
+        : std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+[[gnu::noinline]] void release(void *memory) noexcept {
+    std::free(memory);
+}
+
+void *operator new(size_t size) {
+    return allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void *operator new[](size_t size) {
+    return allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void *operator new(size_t size, std::align_val_t alignment) {
+    return allocate(size, (size_t)alignment);
+}
+void *operator new[](size_t size, std::align_val_t alignment) {
+    return allocate(size, (size_t)alignment);
+}
+
+void operator delete(void *memory) noexcept {
+    release(memory);
+}
+void operator delete[](void *memory) noexcept {
+    release(memory);
+}
+void operator delete(void *memory, size_t) noexcept {
+    release(memory);
+}
+void operator delete[](void *memory, size_t) noexcept {
+    release(memory);
+}
+void operator delete(void *memory, std::align_val_t) noexcept {
+    release(memory);
+}
+void operator delete[](void *memory, std::align_val_t) noexcept {
+    release(memory);
+}
+void operator delete(void *memory, size_t, std::align_val_t) noexcept {
+    release(memory);
+}
+void operator delete[](void *memory, size_t, std::align_val_t) noexcept {
+    release(memory);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Repeats "batch" (which returns its number of operations) for several runs.
+BenchResult measure(const std::string &name, const std::function<long()> &batch) {
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<double> runs;
+    long total = 0;
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+        long ops = 0;
+        const auto start = Clock::now();
+        double elapsed = 0;
+        do {
+            ops += batch();
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        } while (elapsed < BENCH_SECONDS);
+
+        runs.push_back(elapsed * 1e9 / ops);
+        total += ops;
+    }
+
+    return BenchResult {name, *std::min_element(runs.begin(), runs.end()), total};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Lists the legal actions of the side to move.
+std::vector<Board> turn_actions(const Board &state) {
+    return state.get_actions(state.get_turn());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Walks fixed games from the start, collecting positions where a turn begins.
+std::vector<Board> walk_positions(int count) {
+    std::vector<Board> boards;
+    Board board;
+    for (int ply = 0; (int)boards.size() < count; ++ply) {
+        const std::vector<Board> children = turn_actions(board);
+        if (children.empty() || ply % 80 == 79) {
+            board = Board();
+            continue;
+        }
+
+        boards.push_back(board);
+        board = children[(ply * 7 + ply / 80) % children.size()];
+
+        // finish any multi-take, which a block cannot represent
+        while (board.get_turn() == boards.back().get_turn()) {
+            board = turn_actions(board)[0];
+        }
+    }
+    return boards;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Packs positions with one side to move into as many blocks as they need.
+std::vector<BoardBlock> make_blocks(const std::vector<Board> &boards) {
+    std::vector<BoardBlock> blocks(1);
+    for (const auto &board : boards) {
+        if (!blocks.back().add(board)) {
+            blocks.emplace_back();
+            blocks.back().add(board);
+        }
+    }
+    return blocks;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Lists the (source, destination) pairs of one position's block masks.
+std::vector<std::pair<int, int>> block_pairs(const BlockActors &actors, int i) {
+    std::vector<std::pair<int, int>> pairs;
+    for (int d = 0; d < 4; ++d) {
+        const int dir = EnglishGeometry::DIRS[d];
+        for (uint64_t bits = actors.moves[d][i]; bits; bits &= bits - 1) {
+            pairs.emplace_back(lowest_bit(bits), lowest_bit(bits) + dir);
+        }
+        for (uint64_t bits = actors.takes[d][i]; bits; bits &= bits - 1) {
+            pairs.emplace_back(lowest_bit(bits), lowest_bit(bits) + 2 * dir);
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Compares every kernel the CPU supports with Board::get_actions, returning
+// the number of positions any of them got wrong.
+int check_block_kernels(const std::vector<Board> &boards) {
+    int mismatches = 0;
+
+    for (const Color turn : {BLACK, WHITE}) {
+        std::vector<Board> sided;
+        for (const auto &board : boards) {
+            if (board.get_turn() == turn) sided.push_back(board);
+        }
+        const std::vector<BoardBlock> blocks = make_blocks(sided);
+
+        for (int kernel = SCALAR_KERNEL; kernel <= best_kernel(); ++kernel) {
+            BlockActors actors;
+            for (size_t b = 0; b < blocks.size(); ++b) {
+                blocks[b].find_actors(turn, actors, (BlockKernel)kernel);
+
+                for (int i = 0; i < blocks[b].size(); ++i) {
+                    std::vector<std::pair<int, int>> expected;
+                    for (const auto &child : turn_actions(sided[b * BLOCK_SIZE + i])) {
+                        const Action action = child.get_last_action();
+                        expected.emplace_back(action.src, action.dst);
+                    }
+                    std::sort(expected.begin(), expected.end());
+                    mismatches += (block_pairs(actors, i) != expected);
+                }
+            }
+        }
+    }
+
+    return mismatches;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Writes fixed games (multi-takes and promotions included) as PDN and reads
+// them back, returning the number that do not match.
+int check_pdn_round_trip(int count) {
+    std::vector<Game> games(count);
+    for (int g = 0; g < count; ++g) {
+        GameRecord record;
+        for (int ply = 0; ply < 200; ++ply) {
+            const std::vector<Board> children = turn_actions(record.get_board());
+            if (children.empty()) {
+                break;
+            }
+            record.append(children[(ply * 7 + g * 13 + ply / 9) % children.size()]);
+        }
+        games[g].history = record.get_history();
+        games[g].result = (Result)(g % 4);
+    }
+
+    std::stringstream pdn;
+    PdnWriter writer(pdn);
+    for (const auto &game : games) {
+        writer.write(game);
+    }
+
+    // every game must come back once, with the same actions and result
+    PdnReader reader(pdn);
+    int mismatches = 0;
+    int read = 0;
+    Game game;
+    while (reader.next(game)) {
+        if (read >= count) {
+            ++mismatches;
+            continue;
+        }
+
+        const History &expected = games[read].history;
+        bool same = game.result == games[read].result &&
+                    game.history.size() == expected.size();
+        for (size_t i = 0; same && i < expected.size(); ++i) {
+            const Action &a = game.history[i];
+            const Action &b = expected[i];
+            same = a.color == b.color && a.type == b.type && a.src == b.src &&
+                   a.dst == b.dst && a.promoted == b.promoted;
+        }
+        mismatches += !same;
+        ++read;
+    }
+
+    return mismatches + (count - std::min(read, count));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Builds a small book from a fixed game so probes hit real entries.
+int make_book(Book &book, std::vector<uint64_t> &keys) {
+    char path[] = "/tmp/bench_book_XXXXXX";
+    const int fd = mkstemp(path);
+    if (fd < 0) {
+        return ACTION_FAILURE;
+    }
+    close(fd);
+
+    Search::seed(1);
+    GameRecord game;
+    for (int ply = 0; ply < 40; ++ply) {
+        const Board &board = game.get_board();
+        if (turn_actions(board).empty()) break;
+        keys.push_back(board.get_key());
+        game.append((board.get_turn() == BLACK) ? board.ai_black_action(2)
+                                                : board.ai_white_action(2));
+    }
+
+    BookBuilder builder(40);
+    builder.add_game(game.get_history(), -1);
+    const int status = (builder.write(path) == ACTION_SUCCESS)
+        ? book.open(path) : ACTION_FAILURE;
+    unlink(path);
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Opens a small analysis cache on a temporary file, unlinked once it is
+// mapped, so probes and stores touch the mapped buckets alone.
+int make_cache(AnalysisCache &cache) {
+    char path[] = "/tmp/bench_cache_XXXXXX";
+    const int fd = mkstemp(path);
+    if (fd < 0) {
+        return ACTION_FAILURE;
+    }
+    close(fd);
+
+    const int status = cache.open(path, 1);
+    unlink(path);
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::vector<BenchResult> run_benchmarks() {
+    std::vector<Board> positions;
+    for (const char *fen : BENCH_POSITIONS) {
+        Board board;
+        parse_fen(fen, board);
+        positions.push_back(board);
+    }
+
+    std::vector<BenchResult> results;
+
+    results.push_back(measure("evaluate", [&] {
+        float total = 0;
+        for (const auto &board : positions) total += evaluate(board);
+        sink = sink + (uint64_t)total;
+        return (long)positions.size();
+    }));
+
+    results.push_back(measure("movegen", [&] {
+        size_t total = 0;
+        for (const auto &board : positions) total += turn_actions(board).size();
+        sink = sink + total;
+        return (long)positions.size();
+    }));
+
+    // the 10x10 board runs the same generator on 128-bit positions
+    std::vector<Board10x10> boards_10x10 {Board10x10()};
+    for (int ply = 0; ply < 30; ++ply) {
+        const Board10x10 &last = boards_10x10.back();
+        const auto children = last.get_actions(last.get_turn());
+        if (children.empty()) break;
+        boards_10x10.push_back(children[ply % children.size()]);
+    }
+    results.push_back(measure("movegen_10x10", [&] {
+        size_t total = 0;
+        for (const auto &board : boards_10x10) {
+            total += board.get_actions(board.get_turn()).size();
+        }
+        sink = sink + total;
+        return (long)boards_10x10.size();
+    }));
+
+    // masks for a whole block at once, as ns per position
+    std::vector<Board> black_to_move;
+    for (const auto &board : walk_positions(4 * BLOCK_SIZE)) {
+        if (board.get_turn() == BLACK) black_to_move.push_back(board);
+    }
+    const std::vector<BoardBlock> blocks = make_blocks(black_to_move);
+    results.push_back(measure("block_actors", [&] {
+        BlockActors actors;
+        long ops = 0;
+        for (const auto &block : blocks) {
+            block.find_actors(BLACK, actors);
+            sink = sink + actors.moves[0][0] + actors.takes[0][0];
+            ops += block.size();
+        }
+        return ops;
+    }));
+
+    // the engine copies a board and applies an action rather than unmaking
+    std::vector<Action> actions;
+    for (const auto &board : positions) {
+        actions.push_back(turn_actions(board)[0].get_last_action());
+    }
+    results.push_back(measure("make", [&] {
+        for (size_t i = 0; i < positions.size(); ++i) {
+            Board copy = positions[i];
+            sink = sink + copy.player_action(actions[i]);
+        }
+        return (long)positions.size();
+    }));
+
+    results.push_back(measure("square_info", [&] {
+        long ops = 0;
+        for (const auto &board : positions) {
+            for (int sq = 0; sq < BOARD_SIZE; ++sq, ++ops) {
+                sink = sink + board.get_square_info(sq).move_nw;
+            }
+        }
+        return ops;
+    }));
+
+    results.push_back(measure("key", [&] {
+        for (const auto &board : positions) sink = sink + board.get_key();
+        return (long)positions.size();
+    }));
+
+    Book book;
+    std::vector<uint64_t> keys;
+    if (make_book(book, keys) == ACTION_SUCCESS) {
+        results.push_back(measure("book_find", [&] {
+            for (const uint64_t key : keys) {
+                const auto range = book.find(key);
+                sink = sink + (range.second - range.first);
+            }
+            return (long)keys.size();
+        }));
+    }
+
+    // the analysis cache is the engine's transposition table, so its stores
+    // and probes (which hit what was just stored) are timed on their own
+    AnalysisCache cache;
+    if (make_cache(cache) == ACTION_SUCCESS) {
+        std::vector<uint64_t> cache_keys;
+        for (const auto &board : walk_positions(4096)) {
+            cache_keys.push_back(board.get_key());
+        }
+        results.push_back(measure("cache_store", [&] {
+            int depth = 0;
+            for (const uint64_t key : cache_keys) {
+                cache.store(key, CacheEntry {0.5f, ++depth & 0xF, EXACT, 9, 13});
+            }
+            return (long)cache_keys.size();
+        }));
+        results.push_back(measure("cache_probe", [&] {
+            CacheEntry entry;
+            for (const uint64_t key : cache_keys) {
+                sink = sink + cache.probe(key, entry);
+            }
+            return (long)cache_keys.size();
+        }));
+    }
+
+    // nodes per second of a fixed-depth search, as ns per node
+    results.push_back(measure("search_node", [&] {
+        long nodes = 0;
+        for (const auto &board : positions) {
+            MinMax computer(board.get_turn(), BENCH_DEPTH);
+            nodes += computer.search(board, Limits {BENCH_DEPTH}).nodes;
+        }
+        return nodes;
+    }));
+
+    return results;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Counts the allocations a set-up search makes per node: a deep search and a
+// one-ply search of each position should allocate the same, whatever their
+// difference in nodes. MCTS runs with a helper thread, so its thread pool is
+// covered too.
+double search_allocations(Backend backend) {
+    long extra_allocations = 0;
+    long extra_nodes = 0;
+
+    for (const char *fen : BENCH_POSITIONS) {
+        Board board;
+        parse_fen(fen, board);
+
+        // the first search sets up the frames (or arena and helper threads)
+        // every later one reuses
+        std::unique_ptr<Search> computer;
+        if (backend == MCTS_SEARCH) {
+            computer.reset(new Mcts(board.get_turn(), BENCH_DEPTH, 2));
+        } else {
+            computer.reset(new MinMax(board.get_turn(), BENCH_DEPTH));
+        }
+        computer->search(board, Limits {BENCH_DEPTH});
+
+        long before = allocations;
+        const long shallow = computer->search(board, Limits {1}).nodes;
+        const long shallow_allocations = allocations - before;
+
+        before = allocations;
+        const long deep = computer->search(board, Limits {BENCH_DEPTH}).nodes;
+        const long deep_allocations = allocations - before;
+
+        extra_allocations += deep_allocations - shallow_allocations;
+        extra_nodes += deep - shallow;
+    }
+
+    return (extra_nodes > 0) ? (double)extra_allocations / extra_nodes : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Reads a results file written by --save.
+std::map<std::string, double> read_results(const std::string &path) {
+    std::map<std::string, double> results;
+    std::ifstream in(path);
+
+    std::string line;
+    while (std::getline(in, line)) {
+        char name[64];
+        double ns;
+        if (std::sscanf(line.c_str(), " {\"name\": \"%63[^\"]\", \"ns_per_op\": %lf",
+                        name, &ns) == 2) {
+            results[name] = ns;
+        }
+    }
+
+    return results;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv) {
+    const char *save = nullptr;
+    const char *baseline = nullptr;
+    double threshold = 0.10;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--save") == 0) {
+            save = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--baseline") == 0) {
+            baseline = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--threshold") == 0) {
+            threshold = std::atof(argv[i + 1]);
+        }
+    }
+
+    const std::vector<BenchResult> results = run_benchmarks();
+
+    FILE *file = save ? std::fopen(save, "w") : nullptr;
+    if (save && !file) {
+        std::fprintf(stderr, "failed to create %s\n", save);
+        return 1;
+    }
+
+    for (const auto &result : results) {
+        char line[256];
+        std::snprintf(line, sizeof(line),
+                      "{\"name\": \"%s\", \"ns_per_op\": %.2f, \"ops\": %ld}\n",
+                      result.name.c_str(), result.ns_per_op, result.ops);
+        std::fputs(line, stdout);
+        if (file) std::fputs(line, file);
+    }
+
+    if (file) {
+        std::fclose(file);
+    }
+
+    // the search hot paths must not touch the heap
+    bool allocating = false;
+    for (const Backend backend : {MINMAX_SEARCH, MCTS_SEARCH}) {
+        const double per_node = search_allocations(backend);
+        allocating = allocating || per_node != 0;
+        std::fprintf(stderr, "%-12s %.4f allocations per node%s\n",
+                     (backend == MCTS_SEARCH) ? "mcts_node" : "search_node",
+                     per_node, per_node != 0 ? "  ALLOCATES" : "");
+    }
+
+    // and every block kernel must agree with the board's own generator
+    const int mismatches = check_block_kernels(walk_positions(4096));
+    std::fprintf(stderr, "%-12s %d mismatched positions (%s and narrower)%s\n",
+                 "block_actors", mismatches, KERNEL_NAMES[best_kernel()],
+                 mismatches ? "  MISMATCH" : "");
+
+    // and games must survive a trip through PDN
+    const int bad_games = check_pdn_round_trip(300);
+    std::fprintf(stderr, "%-12s %d mismatched games%s\n", "pdn_games",
+                 bad_games, bad_games ? "  MISMATCH" : "");
+
+    const bool failed = allocating || mismatches || bad_games;
+    if (!baseline) {
+        return failed ? 1 : 0;
+    }
+
+    // flag anything slower than the baseline beyond the noise threshold
+    const std::map<std::string, double> base = read_results(baseline);
+    int regressions = 0;
+    for (const auto &result : results) {
+        const auto found = base.find(result.name);
+        if (found == base.end()) {
+            continue;
+        }
+
+        const double change = result.ns_per_op / found->second - 1;
+        const bool regressed = change > threshold;
+        regressions += regressed;
+        std::fprintf(stderr, "%-12s %+7.1f%%%s\n", result.name.c_str(),
+                     change * 100, regressed ? "  REGRESSION" : "");
+    }
+
+    return (regressions || failed) ? 1 : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
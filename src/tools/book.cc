@@ -0,0 +1,122 @@
+/* -----------------------------------------------------------------------------
+book.cc
+
+Builds an opening book offline from self-play or imported games:
+    book <output> [games] [depth] [plies] [seed]
+    book <output> --import <input.pdn|input.cgr> [plies]
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "ai/book.hh"
+#include "ai/search.hh"
+#include "engine/board.hh"
+#include "engine/pdn.hh"
+#include "engine/record.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Games longer than this are scored as draws.
+const auto MAX_GAME_PLIES {300};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Plays one game against itself, returning the winner (-1 for a draw).
+int self_play(int depth, History &history) {
+    GameRecord game;
+
+    for (int ply = 0; ply < MAX_GAME_PLIES; ++ply) {
+        const Board &board = game.get_board();
+        const Color turn = board.get_turn();
+
+        // the side to move loses when it has no action
+        if (board.get_actions(turn).empty()) {
+            history = game.get_history();
+            return (turn == BLACK) ? WHITE : BLACK;
+        }
+
+        game.append((turn == BLACK) ? board.ai_black_action(depth)
+                                    : board.ai_white_action(depth));
+    }
+
+    history = game.get_history();
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Adds every game of a PDN or record file to the book.
+int import_games(const char *path, BookBuilder &builder) {
+    GameSource source;
+    if (source.open(path) != ACTION_SUCCESS) {
+        return ACTION_FAILURE;
+    }
+
+    Game game;
+    while (source.next(game)) {
+        if (game.start.get_key() != Board().get_key()) {
+            continue;
+        }
+
+        const int winner = (game.result == BLACK_WIN) ? BLACK :
+                           (game.result == WHITE_WIN) ? WHITE : -1;
+        builder.add_game(game.history, winner);
+    }
+
+    return ACTION_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <output> [games] [depth] [plies] [seed]\n"
+                             "       %s <output> --import <games> [plies]\n",
+                     argv[0], argv[0]);
+        return 1;
+    }
+
+    const std::string output = argv[1];
+
+    // import mode: build from existing games instead of playing new ones
+    if (argc > 3 && std::strcmp(argv[2], "--import") == 0) {
+        BookBuilder builder((argc > 4) ? std::atoi(argv[4]) : 12);
+        if (import_games(argv[3], builder) != ACTION_SUCCESS ||
+            builder.write(output) != ACTION_SUCCESS) {
+
+            std::fprintf(stderr, "failed to build %s\n", output.c_str());
+            return 1;
+        }
+        return 0;
+    }
+
+    const int games = (argc > 2) ? std::atoi(argv[2]) : 100;
+    const int depth = (argc > 3) ? std::atoi(argv[3]) : 4;
+    const int plies = (argc > 4) ? std::atoi(argv[4]) : 12;
+    if (argc > 5) {
+        Search::seed(std::strtoul(argv[5], nullptr, 10));
+    }
+
+    // play games and accumulate their openings
+    BookBuilder builder(plies);
+    for (int game = 0; game < games; ++game) {
+        History history;
+        const int winner = self_play(depth, history);
+        builder.add_game(history, winner);
+    }
+
+    if (builder.write(output) != ACTION_SUCCESS) {
+        std::fprintf(stderr, "failed to write %s\n", output.c_str());
+        return 1;
+    }
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,75 @@
+/* -----------------------------------------------------------------------------
+games.cc
+
+Converts game files between PDN and the binary record format:
+    games <input.pdn|input.cgr> <output.pdn|output.cgr>
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "engine/pdn.hh"
+#include "engine/record.hh"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s <input> <output>\n", argv[0]);
+        return 1;
+    }
+
+    GameSource source;
+    if (source.open(argv[1]) != ACTION_SUCCESS) {
+        std::fprintf(stderr, "failed to open %s\n", argv[1]);
+        return 1;
+    }
+
+    // pick the output format by extension
+    const std::string output = argv[2];
+    const bool pdn = output.size() >= 4 &&
+                     output.compare(output.size() - 4, 4, ".pdn") == 0;
+
+    std::ofstream text;
+    GameWriter record;
+    if (pdn) {
+        text.open(output);
+    }
+    if ((pdn && !text) ||
+        (!pdn && record.open(output) != ACTION_SUCCESS)) {
+
+        std::fprintf(stderr, "failed to create %s\n", argv[2]);
+        return 1;
+    }
+
+    // stream games across one at a time
+    PdnWriter writer(text);
+    Game game;
+    long count = 0;
+    while (source.next(game)) {
+        if (game.error) {
+            std::fprintf(stderr, "game %ld has a bad move, kept up to it\n",
+                         count);
+        }
+        if (pdn) {
+            writer.write(game);
+        } else if (record.write(game) != ACTION_SUCCESS) {
+            std::fprintf(stderr, "skipped game %ld\n", count);
+        }
+        ++count;
+    }
+
+    if (!pdn && record.close() != ACTION_SUCCESS) {
+        std::fprintf(stderr, "failed to write %s\n", argv[2]);
+        return 1;
+    }
+
+    std::printf("%ld games\n", count);
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,195 @@
+/* -----------------------------------------------------------------------------
+match.cc
+
+Plays two search backends against each other with equal time per move:
+    match [games] [seconds] [backend] [backend] [threads] [--games <file>]
+
+Backends are "minmax" or "mcts". Colors alternate every game. Each side's
+nodes per second is reported along with the score. Given a game file (".pdn",
+or anything else for a binary record), every game is saved with its result,
+so self-play can feed the tuner.
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "ai/mcts.hh"
+#include "ai/minmax.hh"
+#include "ai/search.hh"
+#include "engine/board.hh"
+#include "engine/draw.hh"
+#include "engine/pdn.hh"
+#include "engine/record.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Games longer than this are scored as draws, as are repetitions and long
+// runs of king moves (see draw.hh).
+const auto MAX_GAME_PLIES {300};
+
+// Depth cap for timed searches (the clock ends them first).
+const auto MAX_DEPTH {64};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Effort and results of one player over the match.
+struct Player {
+    Backend backend;
+    long nodes = 0;
+    double seconds = 0;
+    double points = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<Search> make_player(Backend backend, Color color, unsigned threads) {
+    if (backend == MCTS_SEARCH) {
+        return std::unique_ptr<Search>(new Mcts(color, MAX_DEPTH, threads));
+    }
+    return make_search(backend, color, MAX_DEPTH);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Plays one game into "game", returning the winner (-1 for a draw).
+int play(Player &black, Player &white, double seconds, unsigned threads,
+         GameRecord &game) {
+    std::unique_ptr<Search> searches[2] {
+        make_player(black.backend, BLACK, threads),
+        make_player(white.backend, WHITE, threads)
+    };
+    Player *players[2] {&black, &white};
+
+    game = GameRecord();
+    KeyStack keys;
+    for (int ply = 0; ply < MAX_GAME_PLIES; ++ply) {
+        const Board &board = game.get_board();
+        const Color turn = board.get_turn();
+
+        // the side to move loses when it has no action
+        alignas(Board) unsigned char storage[sizeof(Board) * Board::MAX_ACTIONS];
+        if (board.get_actions(turn, reinterpret_cast<Board *>(storage)) == 0) {
+            return (turn == BLACK) ? WHITE : BLACK;
+        }
+
+        // each side sees the game so far, so it can avoid (or seek) a draw
+        searches[turn]->set_game(game);
+
+        const auto start = std::chrono::steady_clock::now();
+        const SearchResult result = searches[turn]->search(board, {MAX_DEPTH, seconds});
+        players[turn]->seconds += std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        players[turn]->nodes += result.nodes;
+
+        game.append(result.best);
+
+        // a third repetition, or 40 moves each without a take or man move
+        keys.assign(game);
+        if (keys.repetitions() >= 2 || keys.reversible() >= DRAW_PLIES) {
+            return -1;
+        }
+    }
+
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv) {
+
+    // the game file option may appear anywhere; the rest are positional
+    std::vector<const char *> args {argv[0]};
+    const char *games_path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            games_path = argv[++i];
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    const size_t count = args.size();
+
+    const int games = (count > 1) ? std::atoi(args[1]) : 10;
+    const double seconds = (count > 2) ? std::atof(args[2]) : 0.1;
+    const unsigned threads = (count > 5) ? std::atoi(args[5]) : 1;
+
+    Player players[2];
+    for (size_t i = 0; i < 2; ++i) {
+        const char *name = (count > 3 + i) ? args[3 + i] : (i ? "mcts" : "minmax");
+        players[i].backend = (std::strcmp(name, "mcts") == 0) ? MCTS_SEARCH
+                                                              : MINMAX_SEARCH;
+    }
+
+    // pick the game file format by extension
+    const std::string output = games_path ? games_path : "";
+    const bool pdn = output.size() >= 4 &&
+                     output.compare(output.size() - 4, 4, ".pdn") == 0;
+    std::ofstream text;
+    GameWriter record;
+    if (pdn) {
+        text.open(output);
+    }
+    if (games_path && ((pdn && !text) ||
+                       (!pdn && record.open(output) != ACTION_SUCCESS))) {
+
+        std::fprintf(stderr, "failed to create %s\n", games_path);
+        return 1;
+    }
+    PdnWriter writer(text);
+
+    // alternate colors every game
+    for (int game = 0; game < games; ++game) {
+        Player &black = players[game % 2];
+        Player &white = players[1 - game % 2];
+
+        GameRecord played;
+        const int winner = play(black, white, seconds, threads, played);
+        if (winner == BLACK) {
+            black.points += 1;
+        } else if (winner == WHITE) {
+            white.points += 1;
+        } else {
+            black.points += 0.5;
+            white.points += 0.5;
+        }
+
+        if (!games_path) {
+            continue;
+        }
+        Game saved;
+        saved.start = played.get_start();
+        saved.history = played.get_history();
+        saved.result = (winner == BLACK) ? BLACK_WIN :
+                       (winner == WHITE) ? WHITE_WIN : DRAW;
+        if (pdn) {
+            writer.write(saved);
+        } else if (record.write(saved) != ACTION_SUCCESS) {
+            std::fprintf(stderr, "skipped game %d\n", game);
+        }
+    }
+
+    if (games_path && !pdn && record.close() != ACTION_SUCCESS) {
+        std::fprintf(stderr, "failed to write %s\n", games_path);
+        return 1;
+    }
+
+    for (const auto &player : players) {
+        std::printf("%-7s %5.1f points  %10.0f nodes/s\n",
+                    (player.backend == MCTS_SEARCH) ? "mcts" : "minmax",
+                    player.points, player.nodes / std::max(player.seconds, 1e-9));
+    }
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
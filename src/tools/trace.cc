@@ -0,0 +1,121 @@
+/* -----------------------------------------------------------------------------
+trace.cc
+
+Converts a search trace (see trace.hh) to Chrome trace_event JSON, for
+chrome://tracing or Perfetto:
+    trace <input> [output.json]
+
+Searches, iterations and sampled nodes become nested spans on their thread's
+track; cache hits, cutoffs, clock checks and dropped events become instants.
+Without an output file the JSON is written to stdout.
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "ai/trace.hh"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// How each event type is drawn: a span phase ("B"/"E") or instant ("i"),
+// its name and what its value means.
+struct EventFormat {
+    const char *phase;
+    const char *name;
+    const char *value;
+};
+
+const EventFormat FORMATS[NUM_TRACE_TYPES] {
+    {"B", "search", "depth"},
+    {"E", "search", "nodes"},
+    {"B", "depth", nullptr},
+    {"E", "depth", "nodes"},
+    {"B", "ply", "depth"},
+    {"E", "ply", nullptr},
+    {"i", "cache hit", "depth"},
+    {"i", "cutoff", "move"},
+    {"i", "time check", "stopped"},
+    {"i", "dropped", "events"},
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Writes one event as a JSON object.
+void write_event(FILE *out, const TraceEvent &event, bool first) {
+    const EventFormat &format = FORMATS[event.type];
+
+    // spans within a search are named by their depth or ply
+    std::string name = format.name;
+    if (event.type >= ITERATION_BEGIN && event.type <= NODE_EXIT) {
+        name += " " + std::to_string(event.ply);
+    }
+
+    std::fprintf(out, "%s\n{\"name\": \"%s\", \"ph\": \"%s\", "
+                 "\"ts\": %.3f, \"pid\": 1, \"tid\": %u",
+                 first ? "" : ",", name.c_str(), format.phase,
+                 event.time / 1000.0, (unsigned)event.thread);
+    if (format.phase[0] == 'i') {
+        std::fprintf(out, ", \"s\": \"t\"");
+    }
+    if (format.value) {
+        std::fprintf(out, ", \"args\": {\"%s\": %u}", format.value,
+                     (unsigned)event.value);
+    }
+    std::fprintf(out, "}");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <input> [output.json]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = std::fopen(argv[1], "rb");
+    TraceHeader header;
+    if (!in || std::fread(&header, sizeof(header), 1, in) != 1 ||
+        std::memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 ||
+        header.version != TRACE_VERSION) {
+
+        std::fprintf(stderr, "failed to read trace %s\n", argv[1]);
+        return 1;
+    }
+
+    FILE *out = (argc > 2) ? std::fopen(argv[2], "w") : stdout;
+    if (!out) {
+        std::fprintf(stderr, "failed to create %s\n", argv[2]);
+        return 1;
+    }
+
+    // events stream straight through; the viewer sorts them by time
+    std::fprintf(out, "{\"otherData\": {\"sample_rate\": %u}, "
+                 "\"traceEvents\": [", (unsigned)header.sample_rate);
+    TraceEvent event;
+    long count = 0;
+    long skipped = 0;
+    while (std::fread(&event, sizeof(event), 1, in) == 1) {
+        if (event.type >= NUM_TRACE_TYPES) {
+            ++skipped;
+            continue;
+        }
+        write_event(out, event, count++ == 0);
+    }
+    std::fprintf(out, "\n]}\n");
+
+    std::fclose(in);
+    if (out != stdout) {
+        std::fclose(out);
+    }
+
+    if (skipped > 0) {
+        std::fprintf(stderr, "skipped %ld unknown events\n", skipped);
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,265 @@
+/* -----------------------------------------------------------------------------
+tune.cc
+
+Tunes evaluation weights against game outcomes (Texel-style):
+    tune <input.pdn|input.cgr> <output> [epochs] [rate] [threads] [weights]
+
+Every position of every finished game is resolved to its quiet leaf and
+labeled with the game's result. The weights are then fit by minimizing the
+logistic loss of sigmoid(K * evaluate(leaf)) against the labels with Adam.
+
+Evaluations are in men, as the searches assume. The scale K (per man) is fit
+first, with the starting weights, and then held; the weight of a man is held
+at its starting value (1.0 by default), so the tuned weights keep that scale.
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "ai/evaluate.hh"
+#include "engine/board.hh"
+#include "engine/pdn.hh"
+#include "engine/record.hh"
+#include "util/thread_pool.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Opening positions say little about the result and are skipped.
+const auto SKIP_PLIES {8};
+
+// Range searched for the scale K, and the steps of the search.
+const double MIN_SCALE {0.01};
+const double MAX_SCALE {10.0};
+const int SCALE_STEPS {60};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Training data stored column-wise: one contiguous array per feature.
+struct FeatureMatrix {
+    std::vector<int8_t> columns[NUM_FEATURES];
+    std::vector<float> labels;
+
+    size_t size() const {
+        return labels.size();
+    }
+};
+
+// Loss gradient of one slice of the data, padded to its own cache lines.
+struct alignas(64) Partial {
+    double grad[NUM_FEATURES];
+    double loss;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Adds the quiet leaf of every position of every finished game.
+int load_positions(const char *path, const Weights &weights, FeatureMatrix &data) {
+    GameSource source;
+    if (source.open(path) != ACTION_SUCCESS) {
+        return ACTION_FAILURE;
+    }
+
+    Game game;
+    while (source.next(game)) {
+        if (game.result == UNKNOWN) {
+            continue;
+        }
+        const float label = (game.result == BLACK_WIN) ? 1.0f :
+                            (game.result == WHITE_WIN) ? 0.0f : 0.5f;
+
+        Board board = game.start;
+        for (size_t ply = 0; ply < game.history.size(); ++ply) {
+            if (board.player_action(game.history[ply]) != ACTION_SUCCESS) {
+                break;
+            }
+            if (ply < SKIP_PLIES) {
+                continue;
+            }
+
+            int8_t features[NUM_FEATURES];
+            get_features(quiesce(board, weights), features);
+            for (int f = 0; f < NUM_FEATURES; ++f) {
+                data.columns[f].push_back(features[f]);
+            }
+            data.labels.push_back(label);
+        }
+    }
+
+    return ACTION_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Accumulates the logistic loss and its gradient over rows [begin, end).
+void gradient(const FeatureMatrix &data, const Weights &weights, double scale,
+              size_t begin, size_t end, Partial &out) {
+    out = Partial {};
+
+    for (size_t i = begin; i < end; ++i) {
+        float eval = 0;
+        for (int f = 0; f < NUM_FEATURES; ++f) {
+            eval += weights.w[f] * data.columns[f][i];
+        }
+
+        // p is the predicted chance black wins
+        const double p = 1.0 / (1.0 + std::exp(-scale * eval));
+        const double y = data.labels[i];
+        out.loss -= y * std::log(p + 1e-12) + (1 - y) * std::log(1 - p + 1e-12);
+
+        const double error = (p - y) * scale;
+        for (int f = 0; f < NUM_FEATURES; ++f) {
+            out.grad[f] += error * data.columns[f][i];
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Computes the mean loss and gradient over every row, one slice per thread.
+double mean_loss(ThreadPool &pool, const FeatureMatrix &data,
+                 const Weights &weights, double scale,
+                 std::vector<Partial> &partials, double grad[NUM_FEATURES]) {
+    const size_t slices = partials.size();
+    for (size_t s = 0; s < slices; ++s) {
+        const size_t begin = data.size() * s / slices;
+        const size_t end = data.size() * (s + 1) / slices;
+        pool.submit([&, s, begin, end] {
+            gradient(data, weights, scale, begin, end, partials[s]);
+        });
+    }
+    pool.wait();
+
+    // reduce the slices
+    double loss = 0;
+    for (int f = 0; f < NUM_FEATURES; ++f) {
+        grad[f] = 0;
+    }
+    for (const auto &partial : partials) {
+        for (int f = 0; f < NUM_FEATURES; ++f) {
+            grad[f] += partial.grad[f] / data.size();
+        }
+        loss += partial.loss;
+    }
+
+    return loss / data.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Finds the scale K that best fits the labels with the given weights, by a
+// golden-section search on log K (the loss is unimodal in K).
+double fit_scale(ThreadPool &pool, const FeatureMatrix &data,
+                 const Weights &weights, std::vector<Partial> &partials) {
+    const double golden = (std::sqrt(5.0) - 1) / 2;
+    double grad[NUM_FEATURES];
+    const auto loss_at = [&](double log_scale) {
+        return mean_loss(pool, data, weights, std::exp(log_scale), partials, grad);
+    };
+
+    double low = std::log(MIN_SCALE);
+    double high = std::log(MAX_SCALE);
+    double a = high - golden * (high - low);
+    double b = low + golden * (high - low);
+    double loss_a = loss_at(a);
+    double loss_b = loss_at(b);
+    for (int step = 0; step < SCALE_STEPS; ++step) {
+        if (loss_a < loss_b) {
+            high = b;
+            b = a;
+            loss_b = loss_a;
+            a = high - golden * (high - low);
+            loss_a = loss_at(a);
+        } else {
+            low = a;
+            a = b;
+            loss_a = loss_b;
+            b = low + golden * (high - low);
+            loss_b = loss_at(b);
+        }
+    }
+
+    return std::exp((low + high) / 2);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s <games> <output> [epochs] [rate] "
+                             "[threads] [weights]\n", argv[0]);
+        return 1;
+    }
+
+    const int epochs = (argc > 3) ? std::atoi(argv[3]) : 500;
+    const double rate = (argc > 4) ? std::atof(argv[4]) : 0.01;
+    const unsigned threads = (argc > 5) ? std::atoi(argv[5]) : 0;
+
+    Weights weights;
+    if (argc > 6 && load_weights(argv[6], weights) != ACTION_SUCCESS) {
+        std::fprintf(stderr, "failed to read %s\n", argv[6]);
+        return 1;
+    }
+
+    FeatureMatrix data;
+    if (load_positions(argv[1], weights, data) != ACTION_SUCCESS ||
+        data.size() == 0) {
+
+        std::fprintf(stderr, "no positions in %s\n", argv[1]);
+        return 1;
+    }
+    std::fprintf(stderr, "%zu positions\n", data.size());
+
+    // split the rows into one slice per thread
+    ThreadPool pool(threads);
+    std::vector<Partial> partials(pool.size());
+
+    // fix the scale of evaluations first, so the weights keep it
+    const double scale = fit_scale(pool, data, weights, partials);
+    std::fprintf(stderr, "scale %.4f per man\n", scale);
+
+    // Adam state
+    double m[NUM_FEATURES] {};
+    double v[NUM_FEATURES] {};
+    const double beta1 = 0.9;
+    const double beta2 = 0.999;
+
+    for (int epoch = 1; epoch <= epochs; ++epoch) {
+        double grad[NUM_FEATURES];
+        const double loss =
+            mean_loss(pool, data, weights, scale, partials, grad);
+
+        // take one Adam step on the mean gradient; a man's weight is the unit
+        // of evaluation, so it stays put
+        for (int f = 0; f < NUM_FEATURES; ++f) {
+            if (f == MEN) {
+                continue;
+            }
+            const double g = grad[f];
+            m[f] = beta1 * m[f] + (1 - beta1) * g;
+            v[f] = beta2 * v[f] + (1 - beta2) * g * g;
+            const double m_hat = m[f] / (1 - std::pow(beta1, epoch));
+            const double v_hat = v[f] / (1 - std::pow(beta2, epoch));
+            weights.w[f] -= rate * m_hat / (std::sqrt(v_hat) + 1e-8);
+        }
+
+        if (epoch % 50 == 0 || epoch == epochs) {
+            std::fprintf(stderr, "epoch %d loss %.6f\n", epoch, loss);
+        }
+    }
+
+    if (save_weights(argv[2], weights) != ACTION_SUCCESS) {
+        std::fprintf(stderr, "failed to write %s\n", argv[2]);
+        return 1;
+    }
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,99 @@
+/* -----------------------------------------------------------------------------
+thread_pool.cc
+
+Name: Joseph Sturm
+Date: 01/27/2020
+----------------------------------------------------------------------------- */
+
+#include "util/thread_pool.hh"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+////////////////////////////////////////////////////////////////////////////////
+
+ThreadPool::ThreadPool(unsigned threads, size_t capacity) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_capacity = std::max<size_t>(1, capacity);
+
+    for (unsigned i = 0; i < threads; ++i) {
+        m_workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+
+    // workers drain the queue before exiting
+    m_job_ready.notify_all();
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::submit(std::function<void()> job) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_job_taken.wait(lock, [this] { return m_jobs.size() < m_capacity; });
+
+    m_jobs.push_back(std::move(job));
+    ++m_unfinished;
+
+    lock.unlock();
+    m_job_ready.notify_one();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_all_done.wait(lock, [this] { return m_unfinished == 0; });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned ThreadPool::size() const {
+    return m_workers.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::work() {
+    for (;;) {
+        std::function<void()> job;
+
+        // take the next job, or exit once stopping with an empty queue
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_job_ready.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+            if (m_jobs.empty()) {
+                return;
+            }
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        m_job_taken.notify_one();
+
+        job();
+
+        // wake waiters once the last job finishes
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_unfinished == 0) {
+            m_all_done.notify_all();
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////